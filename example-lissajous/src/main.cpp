@@ -1,7 +1,13 @@
 #include "ofMain.h"
 #include "ofApp.h"
 
-int main() {
+// example-lissajous --benchmark CURVES FRAMES FILE runs the stress test for
+// FRAMES frames, writes FILE (in the data folder) and quits
+int main(int argc, char** argv) {
     ofSetupOpenGL(1024, 768, OF_WINDOW);
-    ofRunApp(new ofApp());
+    ofApp* app = new ofApp();
+    if (argc == 5 && std::string(argv[1]) == "--benchmark") {
+        app->startBenchmark(std::stoi(argv[2]), std::stoi(argv[3]), argv[4], true);
+    }
+    ofRunApp(app);
 }
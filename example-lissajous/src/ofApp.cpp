@@ -2,7 +2,7 @@
 
 void ofApp::setup() {
     ofSetWindowTitle("ofxVase");
-    ofSetFrameRate(60);
+    ofSetFrameRate(benchmarkLeft > 0 ? 0 : 60);  // uncapped for a command-line benchmark
     ofBackground(30, 30, 35);
     
     renderer.setup();
@@ -13,45 +13,48 @@ void ofApp::update() {
 }
 
 void ofApp::draw() {
+    if (stress) {
+        drawStress();
+    } else {
+        drawCurve();
+    }
+    if (showHelp) drawHelp();
+    
+    if (benchmarkLeft > 0 && --benchmarkLeft == 0) finishBenchmark();
+}
+
+void ofApp::drawCurve() {
     float cx = ofGetWidth() / 2.0f;
     float cy = ofGetHeight() / 2.0f;
     
-    // Build Lissajous curve (pre-allocate for performance)
-    std::vector<glm::vec2> points;
-    std::vector<ofFloatColor> colors;
-    std::vector<float> widths;
-    points.reserve(numPoints + 1);
-    colors.reserve(numPoints + 1);
-    widths.reserve(numPoints + 1);
+    ofxVase::Options opts;
+    opts.joint = ofxVase::JointStyle::Round;
+    opts.cap = ofxVase::CapStyle::Round;
+    opts.feather = true;
+    opts.smoothing = smoothing;  // Catmull-Rom subdivision
+    if (adaptiveSmoothing) {
+        opts.smoothingTolerance = 0.25f;  // max deviation in pixels
+    }
     
-    for (int i = 0; i <= numPoints; i++) {
+    // Generate the Lissajous curve straight into the tessellator; rebuilding in
+    // place does no heap allocation once the buffers have grown
+    poly.rebuild(numPoints + 1, [&](size_t i) {
         float t = (float)i / numPoints * glm::two_pi<float>();
-        float x = cx + amplitude * sin(freqA * t + phase);
-        float y = cy + amplitude * sin(freqB * t);
-        points.push_back(glm::vec2(x, y));
+        ofxVase::VertexInput v;
+        v.pos = glm::vec2(cx + amplitude * sin(freqA * t + phase),
+                          cy + amplitude * sin(freqB * t));
         
         // Rainbow color
         float hue = fmod(t / glm::two_pi<float>() + phase * 0.1f, 1.0f);
-        ofFloatColor c;
-        c.setHsb(hue, 0.8f, 1.0f, 1.0f);
-        colors.push_back(c);
+        v.color.setHsb(hue, 0.8f, 1.0f, 1.0f);
         
         // Width
-        float w = baseWidth;
+        v.width = baseWidth;
         if (animateWidth) {
-            w += widthVariation * (0.5f + 0.5f * sin(t * 3 + phase * 2));
+            v.width += widthVariation * (0.5f + 0.5f * sin(t * 3 + phase * 2));
         }
-        widths.push_back(w);
-    }
-    
-    // Draw
-    ofxVase::Options opts;
-    opts.joint = ofxVase::JointStyle::Round;
-    opts.cap = ofxVase::CapStyle::Round;
-    opts.feather = true;
-    opts.smoothing = smoothing;  // Catmull-Rom subdivision
-    
-    ofxVase::Polyline poly(points, colors, widths, opts);
+        return v;
+    }, opts);
     lastVertexCount = poly.holder.getCount();
     
     // Draw using renderer
@@ -61,33 +64,176 @@ void ofApp::draw() {
     renderer.draw(poly);
     renderer.end();
     ofEnableDepthTest();  // Re-enable if you need it for other 3D content
+}
+
+void ofApp::drawStress() {
+    int count = stressCurves;
+    stressPolys.resize(count);
     
+    // One curve per cell of a grid filling the window. Widths and point counts
+    // scale with the cell, keeping the single curve's density on screen;
+    // 10k curves at full point count would need gigabytes of vertices.
+    int columns = std::max(1, (int)std::ceil(std::sqrt(count * (float)ofGetWidth() / ofGetHeight())));
+    int rows = (count + columns - 1) / columns;
+    float cellW = ofGetWidth() / (float)columns;
+    float cellH = ofGetHeight() / (float)rows;
+    float curveAmplitude = 0.4f * std::min(cellW, cellH);
+    float scale = curveAmplitude / amplitude;
+    int points = std::max(8, (int)(numPoints * scale));
+    const ofxVase::JointStyle joints[] = { ofxVase::JointStyle::Round, ofxVase::JointStyle::Miter,
+                                           ofxVase::JointStyle::Bevel };
     
-    if (showHelp) {
-        ofSetColor(255);
-        int y = 30;
-        int lh = 18;
+    uint64_t start = ofGetElapsedTimeMicros();
+    for (int c = 0; c < count; c++) {
+        float a = 1 + c % 5;
+        float b = 2 + (c / 5) % 4;
+        float curvePhase = phase + c * 0.37f;
+        glm::vec2 center((c % columns + 0.5f) * cellW, (c / columns + 0.5f) * cellH);
         
-        ofDrawBitmapString("ofxVase - Animated Lissajous Curve", 20, y); y += lh * 2;
+        // Joint styles alternate, smoothing steps through 0, half and all of the setting
+        ofxVase::Options opts;
+        opts.joint = joints[c % 3];
+        opts.smoothing = (c / 3) % 3 * smoothing / 2;
+        if (adaptiveSmoothing) {
+            opts.smoothingTolerance = 0.25f;
+        }
         
+        stressPolys[c].rebuild(points + 1, [&](size_t i) {
+            float t = (float)i / points * glm::two_pi<float>();
+            ofxVase::VertexInput v;
+            v.pos = center + curveAmplitude * glm::vec2(sin(a * t + curvePhase), sin(b * t));
+            v.color.setHsb(fmod(t / glm::two_pi<float>() + c * 0.013f, 1.0f), 0.8f, 1.0f, 1.0f);
+            v.width = baseWidth;
+            if (animateWidth) {
+                v.width += widthVariation * (0.5f + 0.5f * sin(t * 3 + curvePhase * 2));
+            }
+            v.width = std::max(1.0f, v.width * scale);
+            return v;
+        }, opts);
+    }
+    uint64_t tessellated = ofGetElapsedTimeMicros();
+    
+    // Everything into one triangle list, uploaded and drawn with a single call
+    stressBatch.clear();
+    for (const auto& poly : stressPolys) {
+        stressBatch.push(poly.holder);
+    }
+    int vertices = stressBatch.getCount();
+    uint64_t merged = ofGetElapsedTimeMicros();
+    
+    // glFinish after each GL stage charges the GPU work to that stage. It keeps
+    // CPU and GPU from overlapping, so the frame rate here is a lower bound.
+    ofEnableAlphaBlending();
+    ofDisableDepthTest();
+    if (vertices > 0) {
+        stressVbo.setVertexData(stressBatch.vertices.data(), vertices, GL_STREAM_DRAW);
+        stressVbo.setColorData(stressBatch.colors.data(), vertices, GL_STREAM_DRAW);
+    }
+    glFinish();
+    uint64_t uploaded = ofGetElapsedTimeMicros();
+    if (vertices > 0) {
+        stressVbo.draw(GL_TRIANGLES, 0, vertices);
+    }
+    glFinish();
+    uint64_t drawn = ofGetElapsedTimeMicros();
+    ofEnableDepthTest();
+    
+    lastTimes.tessellate = (tessellated - start) * 1e-3;
+    lastTimes.mesh = (merged - tessellated) * 1e-3;
+    lastTimes.upload = (uploaded - merged) * 1e-3;
+    lastTimes.draw = (drawn - uploaded) * 1e-3;
+    lastVertexCount = vertices;
+    
+    if (benchmarkLeft > 0) {
+        benchmarkRows.push_back({ lastTimes, ofGetLastFrameTime() * 1000.0, vertices });
+    }
+}
+
+void ofApp::drawHelp() {
+    ofSetColor(255);
+    int y = 30;
+    int lh = 18;
+    
+    if (stress) {
+        ofDrawBitmapString("ofxVase - Stress test", 20, y); y += lh * 2;
+        ofDrawBitmapString("Curves: " + ofToString(stressCurves) + " ([/])", 20, y); y += lh;
+    } else {
+        ofDrawBitmapString("ofxVase - Animated Lissajous Curve", 20, y); y += lh * 2;
         ofDrawBitmapString("Freq A: " + ofToString(freqA, 1) + " (Q/A)", 20, y); y += lh;
         ofDrawBitmapString("Freq B: " + ofToString(freqB, 1) + " (W/S)", 20, y); y += lh;
-        ofDrawBitmapString("Speed:  " + ofToString(phaseSpeed, 1) + " (E/D)", 20, y); y += lh;
-        ofDrawBitmapString("Width:  " + ofToString(baseWidth, 0) + " (R/F)", 20, y); y += lh;
-        ofDrawBitmapString("Var:    " + ofToString(widthVariation, 0) + " (T/G)", 20, y); y += lh;
-        ofDrawBitmapString("Points: " + ofToString(numPoints) + " (Y/U)", 20, y); y += lh;
-        ofDrawBitmapString("Smooth: " + ofToString(smoothing) + " (I/O)", 20, y); y += lh;
-        
-        ofDrawBitmapString("Space - Pause/Play", 20, y); y += lh;
-        ofDrawBitmapString("V - Width animation", 20, y); y += lh;
-        ofDrawBitmapString("1-5 - Presets", 20, y); y += lh;
-        ofDrawBitmapString("H - Hide help", 20, y); y += lh;
-        
-        ofDrawBitmapString("FPS: " + ofToString(ofGetFrameRate(), 0), ofGetWidth() - 80, 30);
-        ofDrawBitmapString("Verts: " + ofToString(lastVertexCount), ofGetWidth() - 100, 50);
+    }
+    ofDrawBitmapString("Speed:  " + ofToString(phaseSpeed, 1) + " (E/D)", 20, y); y += lh;
+    ofDrawBitmapString("Width:  " + ofToString(baseWidth, 0) + " (R/F)", 20, y); y += lh;
+    ofDrawBitmapString("Var:    " + ofToString(widthVariation, 0) + " (T/G)", 20, y); y += lh;
+    ofDrawBitmapString("Points: " + ofToString(numPoints) + " (Y/U)", 20, y); y += lh;
+    ofDrawBitmapString("Smooth: " + ofToString(smoothing) + (adaptiveSmoothing ? " max" : "") + " (I/O)", 20, y); y += lh;
+    
+    ofDrawBitmapString("Space - Pause/Play", 20, y); y += lh;
+    ofDrawBitmapString("V - Width animation", 20, y); y += lh;
+    ofDrawBitmapString("Z - Adaptive smoothing", 20, y); y += lh;
+    ofDrawBitmapString("1-5 - Presets", 20, y); y += lh;
+    ofDrawBitmapString("X - Stress test", 20, y); y += lh;
+    ofDrawBitmapString("B - Benchmark 600 frames", 20, y); y += lh;
+    ofDrawBitmapString("H - Hide help", 20, y); y += lh;
+    
+    ofDrawBitmapString("FPS: " + ofToString(ofGetFrameRate(), 0), ofGetWidth() - 80, 30);
+    ofDrawBitmapString("Verts: " + ofToString(lastVertexCount), ofGetWidth() - 100, 50);
+    if (stress) {
+        int x = ofGetWidth() - 180;
+        ofDrawBitmapString("Tessellate " + ofToString(lastTimes.tessellate, 2) + " ms", x, 80);
+        ofDrawBitmapString("Mesh       " + ofToString(lastTimes.mesh, 2) + " ms", x, 98);
+        ofDrawBitmapString("Upload     " + ofToString(lastTimes.upload, 2) + " ms", x, 116);
+        ofDrawBitmapString("Draw       " + ofToString(lastTimes.draw, 2) + " ms", x, 134);
+        if (benchmarkLeft > 0) {
+            ofDrawBitmapString("Benchmark: " + ofToString(benchmarkLeft) + " frames", x, 162);
+        }
     }
 }
 
+void ofApp::startBenchmark(int curves, int frames, const std::string& path, bool exitWhenDone) {
+    stress = true;
+    stressCurves = std::min(std::max(curves, 1), 10000);
+    benchmarkLeft = std::max(1, frames);
+    benchmarkPath = path;
+    exitAfterBenchmark = exitWhenDone;
+    benchmarkRows.clear();
+    benchmarkRows.reserve(benchmarkLeft);
+    
+    // Measure the work, not the display's refresh rate
+    ofSetVerticalSync(false);
+    ofSetFrameRate(0);
+}
+
+void ofApp::finishBenchmark() {
+    ofSetVerticalSync(true);
+    ofSetFrameRate(60);
+    
+    ofFile out(benchmarkPath, ofFile::WriteOnly);
+    out << "frame,curves,vertices,tessellate_ms,mesh_ms,upload_ms,draw_ms,frame_ms\n";
+    StageTimes sum;
+    double frameSum = 0;
+    for (size_t i = 0; i < benchmarkRows.size(); i++) {
+        const BenchmarkRow& row = benchmarkRows[i];
+        out << i << "," << stressCurves << "," << row.vertices << ","
+            << row.times.tessellate << "," << row.times.mesh << "," << row.times.upload << ","
+            << row.times.draw << "," << row.frame << "\n";
+        sum.tessellate += row.times.tessellate;
+        sum.mesh += row.times.mesh;
+        sum.upload += row.times.upload;
+        sum.draw += row.times.draw;
+        frameSum += row.frame;
+    }
+    out.close();
+    
+    double n = std::max<size_t>(1, benchmarkRows.size());
+    ofLogNotice("ofxVase") << "benchmark, " << stressCurves << " curves, " << benchmarkRows.size()
+                           << " frames, mean ms: tessellate " << sum.tessellate / n
+                           << ", mesh " << sum.mesh / n << ", upload " << sum.upload / n
+                           << ", draw " << sum.draw / n << ", frame " << frameSum / n
+                           << " (" << ofToDataPath(benchmarkPath) << ")";
+    if (exitAfterBenchmark) ofExit();
+}
+
 void ofApp::keyPressed(int key) {
     switch (key) {
         // Frequency A
@@ -122,8 +268,19 @@ void ofApp::keyPressed(int key) {
         // Toggles
         case ' ': phaseSpeed = (phaseSpeed > 0) ? 0 : 0.5f; break;
         case 'v': case 'V': animateWidth = !animateWidth; break;
+        case 'z': case 'Z': adaptiveSmoothing = !adaptiveSmoothing; break;
         case 'h': case 'H': showHelp = !showHelp; break;
         
+        // Stress test
+        case 'x': case 'X': stress = !stress; break;
+        case '[': stressCurves = std::max(1, stressCurves / 2); break;
+        case ']': stressCurves = std::min(10000, stressCurves * 2); break;
+        case 'b': case 'B':
+            if (benchmarkLeft == 0) {
+                startBenchmark(stressCurves, 600, "stress-" + ofToString(stressCurves) + ".csv", false);
+            }
+            break;
+        
         // Presets
         case '1': freqA = 1; freqB = 2; break;  // Figure-8
         case '2': freqA = 3; freqB = 2; break;  // Pretzel
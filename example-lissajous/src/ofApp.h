@@ -10,7 +10,16 @@ public:
     void draw() override;
     void keyPressed(int key) override;
     
+    // Draw curves curves in stress mode for frames frames, write one CSV row
+    // per frame to path (data folder), then quit if exitWhenDone
+    void startBenchmark(int curves, int frames, const std::string& path, bool exitWhenDone);
+    
 private:
+    void drawCurve();
+    void drawStress();
+    void drawHelp();
+    void finishBenchmark();
+    
     // Lissajous parameters
     float freqA = 3.0f;
     float freqB = 4.0f;
@@ -20,15 +29,45 @@ private:
     // Curve settings
     int numPoints = 100;  // Base control points
     int smoothing = 4;    // Catmull-Rom subdivisions (0 = off)
+    bool adaptiveSmoothing = false;  // smoothing becomes the per-segment maximum
     float amplitude = 250.0f;
     float baseWidth = 3.0f;
     float widthVariation = 15.0f;
     bool animateWidth = true;
     
+    // Tessellation, rebuilt every frame
+    ofxVase::Polyline poly;
+    
     // Renderer
     ofxVase::Renderer renderer;
     int lastVertexCount = 0;
     
+    // Stress mode: many curves with their own frequencies, smoothing, joint
+    // style and width animation, batched into one VBO and timed per stage
+    struct StageTimes {
+        double tessellate = 0;  // ms, all Polyline rebuilds
+        double mesh = 0;        // merging the holders into one triangle list
+        double upload = 0;      // VBO upload, finished
+        double draw = 0;        // draw call, finished
+    };
+    bool stress = false;
+    int stressCurves = 100;
+    std::vector<ofxVase::Polyline> stressPolys;
+    ofxVase::VertexArrayHolder stressBatch;
+    ofVbo stressVbo;
+    StageTimes lastTimes;
+    
+    // Fixed-length benchmark of stress mode
+    struct BenchmarkRow {
+        StageTimes times;
+        double frame;   // ms since the previous frame
+        int vertices;
+    };
+    int benchmarkLeft = 0;
+    std::string benchmarkPath;
+    bool exitAfterBenchmark = false;
+    std::vector<BenchmarkRow> benchmarkRows;
+    
     // UI
     bool showHelp = true;
 };
@@ -35,7 +35,7 @@ void ofApp::update() {
 
 void ofApp::rebuildMesh() {
     if (vertices.size() < 2) {
-        currentPolyline = ofxVase::Polyline();
+        currentPolyline.holder.clear();
         return;
     }
     
@@ -47,19 +47,15 @@ void ofApp::rebuildMesh() {
     opts.feathering = feathering;
     opts.worldToScreenRatio = 1.0f;
     
-    // Extract per-vertex data
-    std::vector<glm::vec2> points;
-    std::vector<ofFloatColor> colors;
-    std::vector<float> widths;
+    // Read positions, colors and widths straight out of the VertexData array
+    size_t n = vertices.size();
+    size_t stride = sizeof(VertexData);
+    ofxVase::PointView points(&vertices[0].position, n, stride);
+    ofxVase::ColorView colors(&vertices[0].color, n, stride);
+    ofxVase::WidthView widths(&vertices[0].width, n, stride);
     
-    for (const auto& v : vertices) {
-        points.push_back(v.position);
-        colors.push_back(ofFloatColor(v.color));
-        widths.push_back(v.width);
-    }
-    
-    // Create polyline with per-vertex colors and widths
-    currentPolyline = ofxVase::Polyline(points, colors, widths, opts);
+    // Retessellate with per-vertex colors and widths, reusing the previous buffers
+    currentPolyline.rebuild(points, colors, widths, opts);
 }
 
 void ofApp::draw() {
@@ -81,6 +77,7 @@ void ofApp::draw() {
     
     // Draw control points
     if (showPoints) {
+        handles.clear();
         for (size_t i = 0; i < vertices.size(); i++) {
             const auto& v = vertices[i];
             
@@ -88,20 +85,23 @@ void ofApp::draw() {
             ofNoFill();
             ofSetColor(v.color, 100);
             ofDrawCircle(v.position, v.width / 2);
-            
-            // Draw vertex point
             ofFill();
+            
+            // Vertex points go into one batch, drawn in a single call
             if (i == selectedIndex) {
-                ofSetColor(255, 255, 0);  // Yellow for selected
-                ofDrawCircle(v.position, 8);
+                handles.add(v.position, 8, ofFloatColor(1, 1, 0));  // Yellow for selected
             } else {
-                ofSetColor(v.color);
-                ofDrawCircle(v.position, 6);
+                handles.add(v.position, 6, ofFloatColor(v.color));
             }
-            
-            // Draw vertex number
-            ofSetColor(255);
-            ofDrawBitmapString(ofToString(i), v.position.x + 10, v.position.y - 10);
+        }
+        renderer.begin();
+        renderer.draw(handles);
+        renderer.end();
+        
+        // Draw vertex numbers
+        ofSetColor(255);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            ofDrawBitmapString(ofToString(i), vertices[i].position.x + 10, vertices[i].position.y - 10);
         }
     }
     
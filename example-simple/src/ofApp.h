@@ -43,6 +43,7 @@ private:
     
     // Current polyline (used for rendering)
     ofxVase::Polyline currentPolyline;
+    ofxVase::MarkerBatch handles;
     
     // Renderer
     ofxVase::Renderer renderer;
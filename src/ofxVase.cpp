@@ -1,7 +1,46 @@
 #include "ofxVase.h"
+#include "ofxVaseBatch.h"
+#include "ofxVaseCapture.h"
 
 namespace ofxVase {
 
+// ============================================================================
+// Options
+// ============================================================================
+
+Options& Options::setQuality(Quality q) {
+    switch (q) {
+        case Quality::Draft:
+            approxAngle = 20.0f;
+            approxAngleThin = 30.0f;
+            approxAngleShort = 40.0f;
+            approxThinWidth = 12.0f;
+            arcStep = 2.0f;
+            smoothingToleranceMin = 1.0f;
+            smoothingToleranceMax = 0.0f;
+            break;
+        case Quality::Normal:
+            approxAngle = 10.0f;
+            approxAngleThin = 15.0f;
+            approxAngleShort = 25.0f;
+            approxThinWidth = 7.0f;
+            arcStep = 1.0f;
+            smoothingToleranceMin = 0.0f;
+            smoothingToleranceMax = 0.0f;
+            break;
+        case Quality::High:
+            approxAngle = 3.0f;
+            approxAngleThin = 5.0f;
+            approxAngleShort = 8.0f;
+            approxThinWidth = 3.0f;
+            arcStep = 0.5f;
+            smoothingToleranceMin = 0.0f;
+            smoothingToleranceMax = 0.1f;
+            break;
+    }
+    return *this;
+}
+
 // ============================================================================
 // Utility Functions
 // ============================================================================
@@ -101,6 +140,24 @@ bool intersecting(const glm::vec2& a, const glm::vec2& b,
     return (signedArea(a, b, c) > 0) != (signedArea(a, b, d) > 0);
 }
 
+bool segmentIntersectsRect(const glm::vec2& a, const glm::vec2& b,
+                           const glm::vec2& lo, const glm::vec2& hi) {
+    // Bounding box rejection first, then the separating axis along the segment normal
+    if (std::max(a.x, b.x) < lo.x || std::min(a.x, b.x) > hi.x ||
+        std::max(a.y, b.y) < lo.y || std::min(a.y, b.y) > hi.y) {
+        return false;
+    }
+    glm::vec2 n(a.y - b.y, b.x - a.x);
+    float c = n.x * a.x + n.y * a.y;
+    float d0 = n.x * lo.x + n.y * lo.y - c;
+    float d1 = n.x * hi.x + n.y * lo.y - c;
+    float d2 = n.x * lo.x + n.y * hi.y - c;
+    float d3 = n.x * hi.x + n.y * hi.y - c;
+    if (d0 > 0 && d1 > 0 && d2 > 0 && d3 > 0) return false;
+    if (d0 < 0 && d1 < 0 && d2 < 0 && d3 < 0) return false;
+    return true;
+}
+
 ofFloatColor colorBetween(const ofFloatColor& a, const ofFloatColor& b, float t) {
     t = glm::clamp(t, 0.0f, 1.0f);
     float kt = 1.0f - t;
@@ -124,6 +181,59 @@ glm::vec2 catmullRom(const glm::vec2& p0, const glm::vec2& p1,
     );
 }
 
+namespace {
+
+// Steps a Catmull-Rom span with forward differences: three vec2 adds per sample
+// instead of a full cubic evaluation. Yields t = 0 .. (n-1)/n; the span end is
+// the next span's start.
+struct CatmullRomStepper {
+    glm::vec2 f, d1, d2, d3;
+    
+    CatmullRomStepper(const glm::vec2& p0, const glm::vec2& p1,
+                      const glm::vec2& p2, const glm::vec2& p3, int n) {
+        glm::vec2 a = 0.5f * (-p0 + 3.0f * p1 - 3.0f * p2 + p3);
+        glm::vec2 b = 0.5f * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3);
+        glm::vec2 c = 0.5f * (-p0 + p2);
+        
+        float h = 1.0f / n;
+        float h2 = h * h;
+        float h3 = h2 * h;
+        
+        f = p1;
+        d1 = a * h3 + b * h2 + c * h;
+        d2 = 6.0f * a * h3 + 2.0f * b * h2;
+        d3 = 6.0f * a * h3;
+    }
+    
+    glm::vec2 next() {
+        glm::vec2 p = f;
+        f += d1;
+        d1 += d2;
+        d2 += d3;
+        return p;
+    }
+};
+
+void forwardCatmullRom(const glm::vec2& p0, const glm::vec2& p1,
+                       const glm::vec2& p2, const glm::vec2& p3,
+                       int n, std::vector<glm::vec2>& out) {
+    CatmullRomStepper step(p0, p1, p2, p3, n);
+    for (int j = 0; j < n; j++) {
+        out.push_back(step.next());
+    }
+}
+
+void lerpSpan(const ofFloatColor& c1, const ofFloatColor& c2, float w1, float w2, int n,
+              std::vector<ofFloatColor>& outColors, std::vector<float>& outWidths) {
+    for (int j = 0; j < n; j++) {
+        float t = (float)j / n;
+        outColors.push_back(colorBetween(c1, c2, t));
+        outWidths.push_back(w1 * (1.0f - t) + w2 * t);
+    }
+}
+
+} // namespace
+
 void smoothPolyline(const std::vector<glm::vec2>& points,
                     const std::vector<ofFloatColor>& colors,
                     const std::vector<float>& widths,
@@ -150,12 +260,62 @@ void smoothPolyline(const std::vector<glm::vec2>& points,
         int i2 = i + 1;
         int i3 = std::min(n - 1, i + 2);
         
-        for (int j = 0; j < subdivisions; j++) {
-            float t = (float)j / subdivisions;
-            outPoints.push_back(catmullRom(points[i0], points[i1], points[i2], points[i3], t));
-            outColors.push_back(colorBetween(colors[i1], colors[i2], t));
-            outWidths.push_back(widths[i1] * (1.0f - t) + widths[i2] * t);
-        }
+        forwardCatmullRom(points[i0], points[i1], points[i2], points[i3], subdivisions, outPoints);
+        lerpSpan(colors[i1], colors[i2], widths[i1], widths[i2], subdivisions, outColors, outWidths);
+    }
+    
+    outPoints.push_back(points.back());
+    outColors.push_back(colors.back());
+    outWidths.push_back(widths.back());
+}
+
+int smoothingSubdivisions(const glm::vec2& p0, const glm::vec2& p1,
+                          const glm::vec2& p2, const glm::vec2& p3,
+                          float tolerance, int maxSubdivisions) {
+    // Wang's bound on the equivalent cubic Bezier: a chord of length 1/n stays
+    // within 3*2/8 * max|b[i] - 2b[i+1] + b[i+2]| / n^2 of the curve.
+    glm::vec2 b1 = p1 + (p2 - p0) * (1.0f / 6.0f);
+    glm::vec2 b2 = p2 - (p3 - p1) * (1.0f / 6.0f);
+    float m = std::max(glm::length(p1 - 2.0f * b1 + b2),
+                       glm::length(b1 - 2.0f * b2 + p2));
+    int n = static_cast<int>(ceilf(sqrtf(0.75f * m / std::max(tolerance, 0.0001f))));
+    return glm::clamp(n, 1, std::max(maxSubdivisions, 1));
+}
+
+void smoothPolylineAdaptive(const std::vector<glm::vec2>& points,
+                            const std::vector<ofFloatColor>& colors,
+                            const std::vector<float>& widths,
+                            float tolerance, int maxSubdivisions,
+                            std::vector<glm::vec2>& outPoints,
+                            std::vector<ofFloatColor>& outColors,
+                            std::vector<float>& outWidths) {
+    if (points.size() < 2 || maxSubdivisions < 1) {
+        outPoints = points;
+        outColors = colors;
+        outWidths = widths;
+        return;
+    }
+    
+    int n = (int)points.size();
+    auto spanSteps = [&](int i) {
+        return smoothingSubdivisions(points[std::max(0, i - 1)], points[i],
+                                     points[i + 1], points[std::min(n - 1, i + 2)],
+                                     tolerance, maxSubdivisions);
+    };
+    
+    int outSize = 1;
+    for (int i = 0; i < n - 1; i++) {
+        outSize += spanSteps(i);
+    }
+    outPoints.reserve(outSize);
+    outColors.reserve(outSize);
+    outWidths.reserve(outSize);
+    
+    for (int i = 0; i < n - 1; i++) {
+        int steps = spanSteps(i);
+        forwardCatmullRom(points[std::max(0, i - 1)], points[i],
+                          points[i + 1], points[std::min(n - 1, i + 2)], steps, outPoints);
+        lerpSpan(colors[i], colors[i + 1], widths[i], widths[i + 1], steps, outColors, outWidths);
     }
     
     outPoints.push_back(points.back());
@@ -169,6 +329,10 @@ void smoothPolyline(const std::vector<glm::vec2>& points,
 // VertexArrayHolder
 // ============================================================================
 
+VertexArrayHolder::VertexArrayHolder(std::pmr::memory_resource* mr)
+    : vertices(mr ? mr : std::pmr::get_default_resource()),
+      colors(mr ? mr : std::pmr::get_default_resource()) {}
+
 void VertexArrayHolder::clear() {
     vertices.clear();
     colors.clear();
@@ -216,6 +380,16 @@ void VertexArrayHolder::push(const VertexArrayHolder& other) {
             vertices.push_back(other.vertices[b-1]); colors.push_back(other.colors[b-1]);
             vertices.push_back(other.vertices[b]);   colors.push_back(other.colors[b]);
         }
+    } else if (glmode == DRAW_TRIANGLES && other.glmode == DRAW_LINES) {
+        for (size_t b = 1; b < other.vertices.size(); b += 2) {
+            glm::vec2 a = glm::vec2(other.vertices[b-1]), e = glm::vec2(other.vertices[b]);
+            glm::vec2 n = e - a;
+            if (util::normalize(n) <= 0.0000001f) continue;
+            util::perpen(n);
+            n *= 0.5f;
+            push4(a + n, a - n, e + n, e - n,
+                  other.colors[b-1], other.colors[b-1], other.colors[b], other.colors[b]);
+        }
     }
 }
 
@@ -228,14 +402,13 @@ glm::vec2 VertexArrayHolder::get(int i) const {
 
 ofMesh VertexArrayHolder::toMesh() const {
     ofMesh mesh;
-    mesh.setMode(glmode == DRAW_TRIANGLES ? OF_PRIMITIVE_TRIANGLES : OF_PRIMITIVE_TRIANGLE_STRIP);
+    mesh.setMode(glmode == DRAW_TRIANGLES ? OF_PRIMITIVE_TRIANGLES :
+                 glmode == DRAW_LINES ? OF_PRIMITIVE_LINES : OF_PRIMITIVE_TRIANGLE_STRIP);
     
     if (vertices.empty()) return mesh;
     
-    for (size_t i = 0; i < vertices.size(); i++) {
-        mesh.addVertex(vertices[i]);
-        mesh.addColor(colors[i]);
-    }
+    mesh.addVertices(vertices.data(), vertices.size());
+    mesh.addColors(colors.data(), colors.size());
     
     return mesh;
 }
@@ -253,6 +426,53 @@ void VertexArrayHolder::repeatLastPush() {
     colors.push_back(colors.back());
 }
 
+// ============================================================================
+// Vertex Sinks
+// ============================================================================
+
+InterleavedSink::InterleavedSink(void* data, size_t capacity, const VertexLayout& layout)
+    : data(static_cast<unsigned char*>(data)), capacity(capacity), layout(layout) {}
+
+void InterleavedSink::write(const glm::vec3* positions, const ofFloatColor* colors, size_t n) {
+    size_t room = capacity - count;
+    if (n > room) {
+        dropped += n - room;
+        n = room;
+    }
+    
+    // One pass per attribute keeps the layout checks out of the per-vertex loop
+    unsigned char* base = data + count * layout.stride;
+    size_t posBytes = sizeof(float) * (layout.positionComponents == 3 ? 3 : 2);
+    unsigned char* dst = base + layout.positionOffset;
+    for (size_t i = 0; i < n; i++, dst += layout.stride) {
+        memcpy(dst, &positions[i], posBytes);
+    }
+    
+    dst = base + layout.colorOffset;
+    if (layout.colorFormat == ColorFormat::Float4) {
+        for (size_t i = 0; i < n; i++, dst += layout.stride) {
+            memcpy(dst, &colors[i], sizeof(float) * 4);
+        }
+    } else if (layout.colorFormat == ColorFormat::UByte4) {
+        for (size_t i = 0; i < n; i++, dst += layout.stride) {
+            const ofFloatColor& c = colors[i];
+            unsigned char rgba[4] = {
+                static_cast<unsigned char>(glm::clamp(c.r, 0.0f, 1.0f) * 255.0f + 0.5f),
+                static_cast<unsigned char>(glm::clamp(c.g, 0.0f, 1.0f) * 255.0f + 0.5f),
+                static_cast<unsigned char>(glm::clamp(c.b, 0.0f, 1.0f) * 255.0f + 0.5f),
+                static_cast<unsigned char>(glm::clamp(c.a, 0.0f, 1.0f) * 255.0f + 0.5f)
+            };
+            memcpy(dst, rgba, 4);
+        }
+    }
+    count += n;
+}
+
+void HolderSink::write(const glm::vec3* positions, const ofFloatColor* colors, size_t n) {
+    target.vertices.insert(target.vertices.end(), positions, positions + n);
+    target.colors.insert(target.colors.end(), colors, colors + n);
+}
+
 // ============================================================================
 // Polyline - Core Tessellation (ported from C# reference)
 // ============================================================================
@@ -292,14 +512,14 @@ void Polyline::determineTr(float w, float& t, float& R, float scale) {
     R /= scale;
 }
 
-float Polyline::getPljRoundDangle(float t, float r, float scale) {
-    float sum = (t + r) * scale;
+float Polyline::getPljRoundDangle(float t, float r, const Options& opt) {
+    float sum = (t + r) * opt.worldToScreenRatio;
     if (sum <= 1.44f + 1.08f) {
-        return 0.6f / sum;
+        return 0.6f / sum * opt.arcStep;
     } else if (sum <= 3.25f + 1.08f) {
-        return 2.8f / sum;
+        return 2.8f / sum * opt.arcStep;
     } else {
-        return 4.2f / sum;
+        return 4.2f / sum * opt.arcStep;
     }
 }
 
@@ -325,16 +545,113 @@ void Polyline::makeTrc(const glm::vec2& P1, const glm::vec2& P2,
     R = DP * r;
 }
 
+float Polyline::clipMargin(const WidthView& W, const Options& opt) {
+    // Largest distance any triangle can reach from its source vertex: discs and
+    // round caps reach t + r, square caps and the inner-miter clamp stay within 3x that.
+    float w = 0.0f;
+    for (size_t i = 0; i < W.size(); i++) {
+        w = std::max(w, W[i]);
+    }
+    float t = 0, r = 0;
+    determineTr(w, t, r, opt.worldToScreenRatio);
+    if (opt.feather) {
+        r *= std::max(opt.feathering, 1.0f);
+    }
+    return 3.0f * (t + r);
+}
+
 // ============================================================================
 // Constructors
 // ============================================================================
 
-Polyline::Polyline(const std::vector<glm::vec2>& points,
+Polyline::Polyline(std::pmr::memory_resource* mr)
+    : holder(mr), scratch(mr) {}
+
+Polyline::Polyline(const PointView& points,
                    const ofFloatColor& color,
                    float width,
-                   const Options& opt) {
-    std::vector<ofFloatColor> colors = { color };
-    std::vector<float> widths = { width };
+                   const Options& opt)
+    : holder(opt.memoryResource), scratch(opt.memoryResource) {
+    rebuild(points, color, width, opt);
+}
+
+Polyline::Polyline(const PointView& points,
+                   const ColorView& colors,
+                   const WidthView& widths,
+                   const Options& opt)
+    : holder(opt.memoryResource), scratch(opt.memoryResource) {
+    rebuild(points, colors, widths, opt);
+}
+
+Polyline::Scratch::Scratch(std::pmr::memory_resource* mr)
+    : vertices(mr ? mr : std::pmr::get_default_resource()),
+      ntx(vertices.x.get_allocator()), nty(ntx.get_allocator()),
+      nbx(ntx.get_allocator()), nby(ntx.get_allocator()),
+      coreX(ntx.get_allocator()), coreY(ntx.get_allocator()),
+      fadeX(ntx.get_allocator()), fadeY(ntx.get_allocator()),
+      degenerate(ntx.get_allocator()), miterValid(ntx.get_allocator()),
+      topInner(ntx.get_allocator()),
+      core(mr), fadeOut(mr), fadeIn(mr), anchor(mr) {}
+
+// ============================================================================
+// Rebuild
+// ============================================================================
+
+namespace {
+
+// Vertices staged in the holder before they are handed to a sink
+constexpr int sinkBatch = 4096;
+
+} // namespace
+
+void Polyline::tessellateInto(VertexSink& s,
+                              const PointView& points,
+                              const ofFloatColor& color,
+                              float width,
+                              const Options& opt) {
+    sink = &s;
+    rebuild(points, color, width, opt);
+    flush(true);
+    sink = nullptr;
+}
+
+void Polyline::tessellateInto(VertexSink& s,
+                              const PointView& points,
+                              const ColorView& colors,
+                              const WidthView& widths,
+                              const Options& opt) {
+    sink = &s;
+    rebuild(points, colors, widths, opt);
+    flush(true);
+    sink = nullptr;
+}
+
+// One allocation up front (none once rebuilt at this size). The bound holds
+// with clipping too, which only drops segments. With a sink the holder only
+// stages a batch, so the sink gets the bound instead.
+void Polyline::reserveOutput(size_t n) {
+    if (sink) {
+        sink->reserve(n);
+    } else {
+        holder.reserve(n);
+    }
+}
+
+void Polyline::flush(bool force) {
+    if (!sink || holder.vertices.empty()) return;
+    if (!force && holder.getCount() < sinkBatch) return;
+    sink->write(holder.vertices.data(), holder.colors.data(), holder.vertices.size());
+    holder.clear();
+}
+
+void Polyline::rebuild(const PointView& points,
+                       const ofFloatColor& color,
+                       float width,
+                       const Options& opt) {
+    holder.clear();
+    holder.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLES);
+    ColorView colors(&color, 1);
+    WidthView widths(&width, 1);
     
     InternalOpt inopt;
     inopt.constColor = true;
@@ -342,6 +659,9 @@ Polyline::Polyline(const std::vector<glm::vec2>& points,
     
     int length = static_cast<int>(points.size());
     if (length < 2) return;
+    if (capture::rebuildsEnabled()) capture::rebuild(points, color, width, opt);
+    
+    reserveOutput(estimateVertexCount(points, width, opt));
     
     Options localOpt = opt;
     if (static_cast<int>(localOpt.capPosition) >= 10) {
@@ -357,35 +677,129 @@ Polyline::Polyline(const std::vector<glm::vec2>& points,
         }
     }
     
-    if (length == 2) {
-        StAnchor SA;
-        SA.P[0] = points[0];
-        SA.P[1] = points[1];
-        SA.C[0] = color;
-        SA.C[1] = color;
-        SA.W[0] = width;
-        SA.W[1] = width;
-        segment(SA, localOpt, !inopt.noCapFirst, !inopt.noCapLast, true);
-        holder = SA.vah;
+    if (isAxisAligned(points, widths, opt)) {
+        tessellateAxisAligned(points, colors, width, localOpt, inopt);
+        return;
+    }
+    
+    if (isHairline(widths, opt)) {
+        tessellateHairline(points, colors, widths, localOpt, inopt);
+        return;
+    }
+    
+    if (opt.smoothing > 0) {
+        tessellateSmooth(points, colors, widths, localOpt, inopt);
+        return;
+    }
+    
+    tessellate(points, colors, widths, localOpt, inopt, true);
+}
+
+void Polyline::rebuild(const PointView& points,
+                       const ColorView& colors,
+                       const WidthView& widths,
+                       const Options& opt) {
+    holder.clear();
+    holder.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLES);
+    
+    InternalOpt inopt;
+    inopt.constColor = (colors.size() == 1);
+    inopt.constWeight = (widths.size() == 1);
+    
+    int length = static_cast<int>(points.size());
+    if (length < 2) return;
+    if (capture::rebuildsEnabled()) capture::rebuild(points, colors, widths, opt);
+    
+    reserveOutput(estimateVertexCount(points, widths, opt));
+    
+    if (isAxisAligned(points, widths, opt)) {
+        tessellateAxisAligned(points, colors, widths[0], opt, inopt);
+        return;
+    }
+    
+    if (isHairline(widths, opt)) {
+        tessellateHairline(points, colors, widths, opt, inopt);
+        return;
+    }
+    
+    if (opt.smoothing > 0) {
+        tessellateSmooth(points, colors, widths, opt, inopt);
         return;
     }
     
-    // Use the smart approx/exact switching from the reference
-    int A = 0, B = 0;
+    tessellate(points, colors, widths, opt, inopt, false);
+}
+
+// Delegates rather than assigning, so the holder keeps opt's memory resource
+Polyline::Polyline(const ofPolyline& poly,
+                   const ofFloatColor& color,
+                   float width,
+                   const Options& opt)
+    : Polyline(pointsOf(poly), color, width, opt) {}
+
+// ============================================================================
+// Polyline range and routing
+// ============================================================================
+
+namespace {
+
+// Calls run(first, last, capFirst, capLast) for every maximal run of segments
+// whose stroke can reach the clip rect; without clipping the whole line is a
+// single run. Runs split by the clip rect end far outside it, so only the ends
+// of the line itself are capped.
+template <class PosAt, class RunFn>
+void forEachVisibleRun(int length, PosAt pos, const Options& opt, float margin, RunFn run) {
+    auto visible = [&](int first, int last) {
+        run(first, last, first == 0, last == length - 1);
+    };
+    if (!opt.clip) {
+        visible(0, length - 1);
+        return;
+    }
+    
+    glm::vec2 lo(opt.clipRect.getLeft() - margin, opt.clipRect.getTop() - margin);
+    glm::vec2 hi(opt.clipRect.getRight() + margin, opt.clipRect.getBottom() + margin);
+    
+    int first = -1;
+    for (int i = 0; i < length - 1; i++) {
+        bool reaches = util::segmentIntersectsRect(pos(i), pos(i + 1), lo, hi);
+        if (reaches && first < 0) {
+            first = i;
+        } else if (!reaches && first >= 0) {
+            visible(first, i);
+            first = -1;
+        }
+    }
+    if (first >= 0) {
+        visible(first, length - 1);
+    }
+}
+
+} // namespace
+
+namespace {
+
+// The smart approx/exact switching from the reference: calls range(from, to, approx)
+// for consecutive ranges of first .. last, before polylineRange widens them.
+template <class RangeFn>
+void classifyRanges(const PointView& P, int first, int last,
+                    float width, const Options& opt, RangeFn range) {
+    const float m_pi = glm::pi<float>();
+    float cos_a = cosf(opt.approxAngleThin * m_pi / 180);
+    float cos_b = cosf(opt.approxAngle * m_pi / 180);
+    float cos_c = cosf(opt.approxAngleShort * m_pi / 180);
+    
+    int A = first, B = first;
     bool on = false;
-    for (int i = 1; i < length - 1; i++) {
-        glm::vec2 V1 = points[i] - points[i-1];
-        glm::vec2 V2 = points[i+1] - points[i];
+    for (int i = first + 1; i < last; i++) {
+        glm::vec2 V1 = P[i] - P[i-1];
+        glm::vec2 V2 = P[i+1] - P[i];
         float len = 0;
         len += util::normalize(V1) * 0.5f;
         len += util::normalize(V2) * 0.5f;
         float costho = V1.x * V2.x + V1.y * V2.y;
-        const float m_pi = glm::pi<float>();
-        float cos_a = cosf(15 * m_pi / 180);
-        float cos_b = cosf(10 * m_pi / 180);
-        float cos_c = cosf(25 * m_pi / 180);
         bool approx = false;
-        if ((width * localOpt.worldToScreenRatio < 7 && costho > cos_a) ||
+        if ((width * opt.worldToScreenRatio < opt.approxThinWidth && costho > cos_a) ||
             (costho > cos_b) ||
             (len < width && costho > cos_c)) {
             approx = true;
@@ -393,92 +807,555 @@ Polyline::Polyline(const std::vector<glm::vec2>& points,
         if (approx && !on) {
             A = i;
             on = true;
-            if (A == 1) A = 0;
-            if (A > 1) {
-                polylineRange(points, colors, widths, localOpt, inopt, B, A, false);
+            if (A == first + 1) A = first;
+            if (A > first + 1) {
+                range(B, A, false);
             }
         } else if (!approx && on) {
             B = i;
             on = false;
-            polylineRange(points, colors, widths, localOpt, inopt, A, B, true);
+            range(A, B, true);
         }
     }
-    if (on && B < length - 1) {
-        B = length - 1;
-        polylineRange(points, colors, widths, localOpt, inopt, A, B, true);
-    } else if (!on && A < length - 1) {
-        A = length - 1;
-        polylineRange(points, colors, widths, localOpt, inopt, B, A, false);
+    if (on && B < last) {
+        B = last;
+        range(A, B, true);
+    } else if (!on && A < last) {
+        A = last;
+        range(B, A, false);
     }
-    holder = inopt.holder;
 }
 
-Polyline::Polyline(const std::vector<glm::vec2>& points,
-                   const std::vector<ofFloatColor>& colors,
-                   const std::vector<float>& widths,
-                   const Options& opt) {
-    InternalOpt inopt;
-    
-    if (opt.smoothing > 0 && points.size() >= 2) {
-        std::vector<glm::vec2> smoothPts;
-        std::vector<ofFloatColor> smoothColors;
-        std::vector<float> smoothWidths;
-        
-        std::vector<ofFloatColor> expandedColors = colors;
-        std::vector<float> expandedWidths = widths;
-        if (colors.size() == 1) {
-            expandedColors.resize(points.size(), colors[0]);
+} // namespace
+
+// ============================================================================
+// Pixel snapping
+// ============================================================================
+
+bool Polyline::isAxisAligned(const PointView& P, const WidthView& W, const Options& opt) {
+    if (!opt.pixelSnap || opt.smoothing > 0) return false;
+    for (size_t i = 1; i < W.size(); i++) {
+        if (W[i] != W[0]) return false;
+    }
+    for (size_t i = 1; i < P.size(); i++) {
+        glm::vec2 a = P[i - 1], b = P[i];
+        if (a.x != b.x && a.y != b.y) return false;
+    }
+    return true;
+}
+
+void Polyline::tessellateAxisAligned(const PointView& P, const ColorView& C, float width,
+                                     const Options& opt, const InternalOpt& inopt) {
+    int n = static_cast<int>(P.size());
+    float scale = opt.worldToScreenRatio;
+    float px = width * scale;
+    float w = std::max(1.0f, std::floor(px + 0.5f));
+    float cover = std::min(std::max(px, 0.0f), 1.0f);
+    float capExtent = opt.cap == CapStyle::Butt ? 0.0f : w * 0.5f;
+    
+    // In screen pixels; a stroke centred on c covers [lowEdge(c), lowEdge(c) + w)
+    auto snap = [](float v) { return std::floor(v + 0.5f); };
+    auto lowEdge = [&](float c) { return snap(c - w * 0.5f); };
+    auto color = [&](int i) {
+        ofFloatColor c = C[inopt.constColor ? 0 : i];
+        c.a *= cover;
+        return c;
+    };
+    auto next = [&](int i) {
+        int j = i + 1;
+        while (j < n && P[j] == P[i]) j++;
+        return j;
+    };
+    auto horizontal = [&](int a, int b) { return P[a].y == P[b].y; };
+    
+    // Pixel edge of a segment at its end v, on its lower or upper side. A
+    // perpendicular neighbour's corner square goes to the horizontal segment,
+    // so translucent outlines don't overlap there.
+    enum Neighbour { none, parallel, perpendicular };
+    auto edge = [&](float v, bool lower, bool horiz, Neighbour neighbour, bool cap) {
+        if (neighbour == parallel) return snap(v);
+        if (neighbour == perpendicular) return horiz == lower ? lowEdge(v) : lowEdge(v) + w;
+        float e = cap ? capExtent : 0.0f;
+        return lower ? snap(v - e) : snap(v + e);
+    };
+    auto quad = [&](float lo, float hi, float across, bool horiz,
+                    const ofFloatColor& cLo, const ofFloatColor& cHi) {
+        glm::vec2 p1 = horiz ? glm::vec2(lo, across) : glm::vec2(across, lo);
+        glm::vec2 p4 = horiz ? glm::vec2(hi, across + w) : glm::vec2(across + w, hi);
+        p1 /= scale;
+        p4 /= scale;
+        if (opt.clip && (p4.x < opt.clipRect.getLeft() || p1.x > opt.clipRect.getRight() ||
+                         p4.y < opt.clipRect.getTop() || p1.y > opt.clipRect.getBottom())) {
+            return;
         }
-        if (widths.size() == 1) {
-            expandedWidths.resize(points.size(), widths[0]);
+        glm::vec2 p2 = horiz ? glm::vec2(p1.x, p4.y) : glm::vec2(p4.x, p1.y);
+        glm::vec2 p3 = horiz ? glm::vec2(p4.x, p1.y) : glm::vec2(p1.x, p4.y);
+        holder.push4(p1, p2, p3, p4, cLo, cLo, cHi, cHi);
+        flush(false);
+    };
+    
+    int a = 0, b = next(0);
+    if (b >= n) {
+        // All points coincide: a square dot where the exact path draws a round one
+        if (capExtent > 0.0f && !(inopt.noCapFirst && inopt.noCapLast)) {
+            glm::vec2 p = P[0] * scale;
+            quad(lowEdge(p.x), lowEdge(p.x) + w, lowEdge(p.y), true, color(0), color(0));
         }
+        return;
+    }
+    
+    // A closed outline joins its last segment to its first instead of capping them
+    bool closed = n > 3 && P[0] == P[n - 1];
+    bool firstHoriz = horizontal(0, b);
+    bool prevHoriz = false;
+    if (closed) {
+        int j = n - 2;
+        while (P[j] == P[n - 1]) j--;
+        prevHoriz = horizontal(j, n - 1);
+    }
+    bool hasPrev = closed;
+    
+    while (b < n) {
+        int c = next(b);
+        bool horiz = horizontal(a, b);
+        bool hasNext = c < n || closed;
+        bool nextHoriz = c < n ? horizontal(b, c) : firstHoriz;
+        Neighbour atA = !hasPrev ? none : prevHoriz == horiz ? parallel : perpendicular;
+        Neighbour atB = !hasNext ? none : nextHoriz == horiz ? parallel : perpendicular;
         
-        util::smoothPolyline(points, expandedColors, expandedWidths, opt.smoothing,
-                            smoothPts, smoothColors, smoothWidths);
-        
-        inopt.constColor = false;
-        inopt.constWeight = false;
+        glm::vec2 pa = P[a] * scale, pb = P[b] * scale;
+        float va = horiz ? pa.x : pa.y, vb = horiz ? pb.x : pb.y;
+        bool aLower = va < vb;
+        float ea = edge(va, aLower, horiz, atA, !inopt.noCapFirst);
+        float eb = edge(vb, !aLower, horiz, atB, !inopt.noCapLast);
+        float lo = aLower ? ea : eb, hi = aLower ? eb : ea;
+        if (hi > lo) {
+            quad(lo, hi, lowEdge(horiz ? pa.y : pa.x), horiz,
+                 color(aLower ? a : b), color(aLower ? b : a));
+        }
         
-        int length = static_cast<int>(smoothPts.size());
-        polylineRange(smoothPts, smoothColors, smoothWidths, opt, inopt, 0, length - 1, false);
+        prevHoriz = horiz;
+        hasPrev = true;
+        a = b;
+        b = c;
+    }
+}
+
+// ============================================================================
+// Hairlines
+// ============================================================================
+
+bool Polyline::isHairline(const WidthView& W, const Options& opt) {
+    if (opt.hairlineWidth <= 0.0f) return false;
+    float limit = opt.hairlineWidth / opt.worldToScreenRatio;
+    for (size_t i = 0; i < W.size(); i++) {
+        if (!(W[i] <= limit)) return false;
+    }
+    return true;
+}
+
+void Polyline::tessellateHairline(const PointView& P,
+                                  const ColorView& C,
+                                  const WidthView& W,
+                                  const Options& opt, const InternalOpt& inopt) {
+    // A sink only takes triangles
+    if (opt.hairlineLines && !sink) holder.setGlDrawMode(VertexArrayHolder::DRAW_LINES);
+    
+    float margin = opt.clip ? clipMargin(W, opt) : 0.0f;
+    auto runs = [&](int length, auto pos, auto color, auto width) {
+        forEachVisibleRun(length, pos, opt, margin,
+                          [&](int first, int last, bool capFirst, bool capLast) {
+            hairlineRun(pos, color, width, first, last, opt,
+                        !inopt.noCapFirst && capFirst, !inopt.noCapLast && capLast);
+        });
+    };
+    
+    if (opt.smoothing > 0) {
+        VertexStream& V = scratch.vertices;
+        smoothVertices(P, C, W, opt, inopt, V);
+        runs(V.size(), [&](int i) { return V.pos(i); }, [&](int i) { return V.col[i]; },
+             [&](int i) { return inopt.constWeight ? W[0] : V.w[i]; });
     } else {
-        inopt.constColor = (colors.size() == 1);
-        inopt.constWeight = (widths.size() == 1);
-        
-        int length = static_cast<int>(points.size());
-        if (length < 2) return;
-        
-        polylineRange(points, colors, widths, opt, inopt, 0, length - 1, false);
+        runs(static_cast<int>(P.size()), [&](int i) { return P[i]; },
+             [&](int i) { return C[inopt.constColor ? 0 : i]; },
+             [&](int i) { return W[inopt.constWeight ? 0 : i]; });
     }
-    holder = inopt.holder;
 }
 
-Polyline::Polyline(const ofPolyline& poly,
-                   const ofFloatColor& color,
-                   float width,
-                   const Options& opt) {
-    std::vector<glm::vec2> points;
-    points.reserve(poly.size());
-    for (const auto& v : poly.getVertices()) {
-        points.push_back(glm::vec2(v.x, v.y));
+template <class PosAt, class ColorAt, class WidthAt>
+void Polyline::hairlineRun(PosAt pos, ColorAt color, WidthAt width, int first, int last,
+                           const Options& opt, bool capFirst, bool capLast) {
+    float scale = opt.worldToScreenRatio;
+    float feather = (opt.feather && !opt.noFeatherAtCore) ? opt.feathering : 1.0f;
+    bool lines = holder.glmode == VertexArrayHolder::DRAW_LINES;
+    capFirst = capFirst && opt.cap != CapStyle::Butt;
+    capLast = capLast && opt.cap != CapStyle::Butt;
+    
+    // A tent profile, full color on the path fading out h to either side,
+    // puts down the same ink as the exact path's core of 2t and fade of r
+    auto half = [&](float w) {
+        float t = 0, r = 0;
+        determineTr(w, t, r, scale);
+        return 2.0f * t + r * feather;
+    };
+    // Sub-pixel widths fade out as the exact path's do
+    auto core = [&](int i) {
+        ofFloatColor c = color(i);
+        float px = width(i) * scale;
+        if (px < 1.0f) c.a *= std::max(px, 0.0f);
+        return c;
+    };
+    // Two triangles close the notch on the outer side of a turn from d0 to d1
+    auto joint = [&](const glm::vec2& p, const glm::vec2& d0, const glm::vec2& d1,
+                     float h, const ofFloatColor& c) {
+        if (d0.x * d1.x + d0.y * d1.y > 0.9999f) return;
+        glm::vec2 n0 = d0, n1 = d1;
+        util::perpen(n0);
+        util::perpen(n1);
+        if (d0.x * d1.y - d0.y * d1.x > 0.0f) {
+            n0 = -n0;
+            n1 = -n1;
+        }
+        glm::vec2 m = n0 + n1;
+        if (util::normalize(m) < 0.0001f) m = d0;   // doubling back
+        holder.push(p, c); holder.pushF(p + n0 * h, c); holder.pushF(p + m * h, c);
+        holder.push(p, c); holder.pushF(p + m * h, c); holder.pushF(p + n1 * h, c);
+    };
+    // Round and square caps alike: a short tip of two triangles
+    auto cap = [&](const glm::vec2& p, const glm::vec2& dir, float h, const ofFloatColor& c) {
+        glm::vec2 n = dir;
+        util::perpen(n);
+        glm::vec2 tip = p + dir * h;
+        holder.push(p, c); holder.pushF(p + n * h, c); holder.pushF(tip, c);
+        holder.push(p, c); holder.pushF(tip, c); holder.pushF(p - n * h, c);
+    };
+    
+    int a = first;
+    glm::vec2 prevDir(0);
+    bool started = false;
+    for (int b = first + 1; b <= last; b++) {
+        glm::vec2 pa = pos(a), pb = pos(b);
+        glm::vec2 d = pb - pa;
+        if (util::normalize(d) < 0.0001f) continue;   // coincident points join the next segment
+        ofFloatColor ca = core(a), cb = core(b);
+        if (lines) {
+            holder.push(pa, ca);
+            holder.push(pb, cb);
+        } else {
+            float ha = half(width(a)), hb = half(width(b));
+            if (started) {
+                joint(pa, prevDir, d, ha, ca);
+            } else if (capFirst) {
+                cap(pa, -d, ha, ca);
+            }
+            glm::vec2 n = d;
+            util::perpen(n);
+            for (float side : { 1.0f, -1.0f }) {
+                glm::vec2 na = n * (ha * side), nb = n * (hb * side);
+                holder.push(pa, ca); holder.pushF(pa + na, ca); holder.pushF(pb + nb, cb);
+                holder.push(pa, ca); holder.pushF(pb + nb, cb); holder.push(pb, cb);
+            }
+        }
+        flush(false);
+        prevDir = d;
+        started = true;
+        a = b;
+    }
+    if (lines) return;
+    
+    if (started) {
+        if (capLast) cap(pos(a), prevDir, half(width(a)), core(a));
+    } else if (capFirst || capLast) {
+        // All points coincide: a dot, as the exact path draws
+        glm::vec2 p = pos(first);
+        float h = half(width(first));
+        ofFloatColor c = core(first);
+        cap(p, glm::vec2(1, 0), h, c);
+        cap(p, glm::vec2(-1, 0), h, c);
+    }
+}
+
+size_t Polyline::hairlineVertexBound(const PointView& points, const Options& opt) {
+    int n = static_cast<int>(points.size());
+    if (n < 2) return 0;
+    
+    size_t samples = n;
+    if (opt.smoothing > 0) {
+        samples = 1;
+        float tolerance = opt.getSmoothingTolerance() / opt.worldToScreenRatio;
+        for (int i = 0; i < n - 1; i++) {
+            samples += tolerance <= 0 ? opt.smoothing :
+                util::smoothingSubdivisions(points[std::max(0, i - 1)], points[i],
+                                            points[i + 1], points[std::min(n - 1, i + 2)],
+                                            tolerance, opt.smoothing);
+        }
     }
-    *this = Polyline(points, color, width, opt);
+    // A quad pair per segment, a joint patch per inner vertex and two caps;
+    // GL_LINES output stays well within it
+    return 12 * (samples - 1) + 6 * (samples - 2) + 12;
 }
 
 // ============================================================================
-// Polyline range and routing
+// Output size estimate
 // ============================================================================
 
-void Polyline::polylineRange(const std::vector<glm::vec2>& P,
-                              const std::vector<ofFloatColor>& C,
-                              const std::vector<float>& W,
+void Polyline::strokeVertexBounds(float maxWidth, const Options& opt,
+                                  size_t& disc, size_t& cap) {
+    // t + r grows with the width, and getPljRoundDangle shrinks within each of
+    // its buckets, so the finest arc for any width up to maxWidth is at a bucket top.
+    float t = 0, r = 0;
+    determineTr(maxWidth, t, r, opt.worldToScreenRatio);
+    if (opt.feather && !opt.noFeatherAtCore) {
+        r *= opt.feathering;
+    }
+    float sum = (t + r) * opt.worldToScreenRatio;
+    float dangle = 0.6f / std::min(sum, 1.44f + 1.08f);
+    if (sum > 1.44f + 1.08f) dangle = std::min(dangle, 2.8f / std::min(sum, 3.25f + 1.08f));
+    if (sum > 3.25f + 1.08f) dangle = std::min(dangle, 4.2f / sum);
+    dangle *= opt.arcStep;
+    
+    const float pi = glm::pi<float>();
+    disc = 9 * std::max<size_t>(8, static_cast<size_t>(2.0f * pi / dangle));
+    
+    // Round cap strip: core and fade arcs of up to pi / dangle + 1 pairs each,
+    // their end pairs and a jump, expanded to triangles. Square caps take 12.
+    size_t arcSteps = std::min<size_t>(200, static_cast<size_t>(pi / dangle) + 2);
+    cap = 3 * (14 + 4 * arcSteps);
+}
+
+size_t Polyline::estimateVertexCount(const PointView& points, float width,
+                                     const Options& opt) {
+    int n = static_cast<int>(points.size());
+    if (n < 2) return 0;
+    if (isAxisAligned(points, WidthView(&width, 1), opt)) return 6 * (n - 1);
+    if (isHairline(WidthView(&width, 1), opt)) return hairlineVertexBound(points, opt);
+    
+    if (opt.smoothing > 0) {
+        // Smoothed lines always take the exact path
+        return exactVertexBound(points, WidthView(&width, 1), opt);
+    }
+    
+    size_t disc = 0, cap = 0;
+    strokeVertexBounds(width, opt, disc, cap);
+    if (n == 2) return 18 + 2 * cap;
+    
+    // Exact path: a disc and a joint fill per vertex and a body per segment, which
+    // is a disc instead when the segment degenerates (zero length at constant width)
+    auto body = [&](int i) {
+        return glm::length(points[i + 1] - points[i]) < 0.002f ? std::max<size_t>(18, disc) : 18;
+    };
+    
+    size_t count = 0;
+    classifyRanges(points, 0, n - 1, width, opt, [&](int from, int to, bool approx) {
+        if (from > 0) from--;
+        if (approx) {
+            // Three strips of two vertices per step, then two capped segments
+            count += 18 * (to - from) + 2 * (18 + cap);
+            return;
+        }
+        count += (to - from + 1) * (disc + 9);
+        for (int i = from; i < to; i++) {
+            count += body(i);
+        }
+    });
+    return count;
+}
+
+size_t Polyline::estimateVertexCount(const PointView& points,
+                                     const WidthView& widths,
+                                     const Options& opt) {
+    if (widths.empty()) return 0;
+    if (points.size() >= 2 && isAxisAligned(points, widths, opt)) return 6 * (points.size() - 1);
+    if (isHairline(widths, opt)) return hairlineVertexBound(points, opt);
+    return exactVertexBound(points, widths, opt);
+}
+
+size_t Polyline::exactVertexBound(const PointView& points,
+                                  const WidthView& widths, const Options& opt) {
+    int n = static_cast<int>(points.size());
+    if (n < 2) return 0;
+    
+    bool constWidth = widths.size() == 1;
+    auto width = [&](int i) { return widths[constWidth ? 0 : i]; };
+    auto discAt = [&](float w) {
+        size_t disc = 0, cap = 0;
+        strokeVertexBounds(w, opt, disc, cap);
+        return disc;
+    };
+    auto radius = [&](int i) {
+        float t = 0, r = 0;
+        determineTr(width(i), t, r, opt.worldToScreenRatio);
+        if (opt.feather && !opt.noFeatherAtCore) r *= opt.feathering;
+        return t + r;
+    };
+    
+    if (opt.smoothing <= 0) {
+        // A segment degenerates into a disc when it is shorter than its radius change
+        size_t count = n * 9;
+        for (int i = 0; i < n; i++) {
+            count += discAt(width(i));
+        }
+        for (int i = 0; i < n - 1; i++) {
+            float d = glm::length(points[i + 1] - points[i]);
+            bool degenerate = d < 0.002f || d <= fabsf(radius(i) - radius(i + 1)) * 1.01f;
+            count += degenerate ? std::max<size_t>(18, discAt(width(i + 1))) : 18;
+        }
+        return count;
+    }
+    
+    // Spline samples interpolate the widths of their span; any of them may degenerate
+    auto exact = [&](float w) { size_t disc = discAt(w); return disc + std::max<size_t>(18, disc) + 9; };
+    size_t count = exact(width(n - 1));
+    float tolerance = opt.getSmoothingTolerance() / opt.worldToScreenRatio;
+    for (int i = 0; i < n - 1; i++) {
+        int steps = opt.smoothing;
+        if (tolerance > 0) {
+            steps = util::smoothingSubdivisions(points[std::max(0, i - 1)], points[i],
+                                                points[i + 1], points[std::min(n - 1, i + 2)],
+                                                tolerance, opt.smoothing);
+        }
+        count += steps * exact(std::max(width(i), width(i + 1)));
+    }
+    return count;
+}
+
+void Polyline::tessellate(const PointView& P,
+                          const ColorView& C,
+                          const WidthView& W,
+                          const Options& opt, const InternalOpt& inopt,
+                          bool classify) {
+    int length = static_cast<int>(P.size());
+    if (length < 2) return;
+    
+    float margin = opt.clip ? clipMargin(W, opt) : 0.0f;
+    forEachVisibleRun(length, [&](int i) { return P[i]; }, opt, margin,
+                      [&](int first, int last, bool capFirst, bool capLast) {
+        InternalOpt runInopt = inopt;
+        runInopt.first = first;
+        runInopt.last = last;
+        runInopt.noCapFirst = inopt.noCapFirst || !capFirst;
+        runInopt.noCapLast = inopt.noCapLast || !capLast;
+        tessellateRun(P, C, W, opt, runInopt, classify);
+    });
+}
+
+void Polyline::tessellateSmooth(const PointView& P,
+                                const ColorView& C,
+                                const WidthView& W,
+                                const Options& opt, const InternalOpt& inopt) {
+    // Spline samples go straight into the exact tessellator's per-vertex
+    // scratch; constant color and width are never expanded.
+    VertexStream& V = scratch.vertices;
+    smoothVertices(P, C, W, opt, inopt, V);
+    
+    int length = V.size();
+    float margin = opt.clip ? clipMargin(W, opt) : 0.0f;
+    forEachVisibleRun(length, [&](int i) { return V.pos(i); }, opt, margin,
+                      [&](int first, int last, bool, bool) {
+        int n = last - first + 1;
+        polylineExact(V, first, n, opt, 0, n);
+    });
+}
+
+void Polyline::smoothVertices(const PointView& P,
+                              const ColorView& C,
+                              const WidthView& W,
+                              const Options& opt, const InternalOpt& inopt,
+                              VertexStream& V) {
+    int n = static_cast<int>(P.size());
+    float tolerance = opt.getSmoothingTolerance() / opt.worldToScreenRatio;
+    auto spanSteps = [&](int i) {
+        if (tolerance <= 0) return opt.smoothing;
+        return util::smoothingSubdivisions(P[std::max(0, i - 1)], P[i],
+                                           P[i + 1], P[std::min(n - 1, i + 2)],
+                                           tolerance, opt.smoothing);
+    };
+    
+    int count = 1;
+    for (int i = 0; i < n - 1; i++) {
+        count += spanSteps(i);
+    }
+    V.resize(count);
+    
+    int k = 0;
+    for (int i = 0; i < n - 1; i++) {
+        int steps = spanSteps(i);
+        util::CatmullRomStepper step(P[std::max(0, i - 1)], P[i],
+                                     P[i + 1], P[std::min(n - 1, i + 2)], steps);
+        for (int j = 0; j < steps; j++, k++) {
+            float t = (float)j / steps;
+            glm::vec2 pos = step.next();
+            V.x[k] = pos.x;
+            V.y[k] = pos.y;
+            V.col[k] = inopt.constColor ? C[0] : util::colorBetween(C[i], C[i + 1], t);
+            if (!inopt.constWeight) V.w[k] = W[i] * (1.0f - t) + W[i + 1] * t;
+        }
+    }
+    V.x[k] = P[n - 1].x;
+    V.y[k] = P[n - 1].y;
+    V.col[k] = C[inopt.constColor ? 0 : n - 1];
+    V.w[k] = W[inopt.constWeight ? 0 : n - 1];
+    
+    computeRadii(V, opt, inopt.constWeight, W[0]);
+}
+
+void Polyline::computeRadii(VertexStream& V, const Options& opt, bool constWeight, float width) {
+    float feather = (opt.feather && !opt.noFeatherAtCore) ? opt.feathering : 1.0f;
+    int n = V.size();
+    if (constWeight) {
+        float t = 0, r = 0;
+        determineTr(width, t, r, opt.worldToScreenRatio);
+        std::fill(V.t.begin(), V.t.end(), t);
+        std::fill(V.r.begin(), V.r.end(), r * feather);
+    } else {
+        batch::determineTr(V.w.data(), V.t.data(), V.r.data(), n,
+                           opt.worldToScreenRatio, feather);
+    }
+}
+
+void Polyline::tessellateRun(const PointView& P,
+                             const ColorView& C,
+                             const WidthView& W,
+                             const Options& opt, InternalOpt& inopt,
+                             bool classify) {
+    int first = inopt.first;
+    int last = inopt.last;
+    
+    if (!classify) {
+        polylineRange(P, C, W, opt, inopt, first, last, false);
+        return;
+    }
+    
+    if (last - first == 1) {
+        StAnchor& SA = scratch.anchor;
+        SA.vah.clear();
+        SA.P[0] = P[first];
+        SA.P[1] = P[last];
+        SA.C[0] = C[inopt.constColor ? 0 : first];
+        SA.C[1] = C[inopt.constColor ? 0 : last];
+        SA.W[0] = W[inopt.constWeight ? 0 : first];
+        SA.W[1] = W[inopt.constWeight ? 0 : last];
+        segment(SA, opt, !inopt.noCapFirst, !inopt.noCapLast, true);
+        holder.push(SA.vah);
+        flush(false);
+        return;
+    }
+    
+    classifyRanges(P, first, last, W[0], opt, [&](int from, int to, bool approx) {
+        polylineRange(P, C, W, opt, inopt, from, to, approx);
+    });
+}
+
+void Polyline::polylineRange(const PointView& P,
+                              const ColorView& C,
+                              const WidthView& W,
                               const Options& opt, InternalOpt& inopt,
                               int from, int to, bool approx) {
     InternalOpt localInopt = inopt;
-    if (from > 0) from--;
+    if (from > inopt.first) from--;
     
-    localInopt.joinFirst = (from != 0);
-    localInopt.joinLast = (to != static_cast<int>(P.size()) - 1);
+    localInopt.joinFirst = (from != inopt.first);
+    localInopt.joinLast = (to != inopt.last);
     localInopt.noCapFirst = inopt.noCapFirst || localInopt.joinFirst;
     localInopt.noCapLast = inopt.noCapLast || localInopt.joinLast;
     
@@ -487,13 +1364,11 @@ void Polyline::polylineRange(const std::vector<glm::vec2>& P,
     } else {
         polylineExact(P, C, W, opt, localInopt, from, to);
     }
-    
-    inopt.holder.push(localInopt.holder);
 }
 
-void Polyline::polylineApprox(const std::vector<glm::vec2>& P,
-                               const std::vector<ofFloatColor>& C,
-                               const std::vector<float>& W,
+void Polyline::polylineApprox(const PointView& P,
+                               const ColorView& C,
+                               const WidthView& W,
                                const Options& opt, InternalOpt& inopt,
                                int from, int to) {
     if (to - from + 1 < 2) return;
@@ -502,10 +1377,18 @@ void Polyline::polylineApprox(const std::vector<glm::vec2>& P,
     bool joinFirst = inopt.joinFirst;
     bool joinLast = inopt.joinLast;
     
-    VertexArrayHolder vcore, vfadeo, vfadei;
+    VertexArrayHolder& vcore = scratch.core;
+    VertexArrayHolder& vfadeo = scratch.fadeOut;
+    VertexArrayHolder& vfadei = scratch.fadeIn;
+    vcore.clear();
+    vfadeo.clear();
+    vfadei.clear();
     vcore.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLE_STRIP);
     vfadeo.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLE_STRIP);
     vfadei.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLE_STRIP);
+    vcore.reserve(2 * (to - from));
+    vfadeo.reserve(2 * (to - from));
+    vfadei.reserve(2 * (to - from));
     
     auto color = [&](int i) -> ofFloatColor {
         return C[inopt.constColor ? 0 : i];
@@ -514,11 +1397,19 @@ void Polyline::polylineApprox(const std::vector<glm::vec2>& P,
         return W[inopt.constWeight ? 0 : i];
     };
     
+    // With a constant width every step shares the same core/fade radii
+    float feather = (opt.feather && !opt.noFeatherAtCore) ? opt.feathering : 1.0f;
+    float constT = 0, constR = 0;
+    if (inopt.constWeight) {
+        determineTr(W[0], constT, constR, opt.worldToScreenRatio);
+        constR *= feather;
+    }
+    
     auto polyStep = [&](int i, const glm::vec2& pp, float ww, const ofFloatColor& cc) {
-        float t = 0, r = 0;
-        determineTr(ww, t, r, opt.worldToScreenRatio);
-        if (opt.feather && !opt.noFeatherAtCore) {
-            r *= opt.feathering;
+        float t = constT, r = constR;
+        if (!inopt.constWeight) {
+            determineTr(ww, t, r, opt.worldToScreenRatio);
+            r *= feather;
         }
         glm::vec2 V = P[i] - P[i-1];
         util::perpen(V);
@@ -550,7 +1441,8 @@ void Polyline::polylineApprox(const std::vector<glm::vec2>& P,
     polyStep(to, P_las, W_las, C_las);
     
     // First cap
-    StAnchor SA;
+    StAnchor& SA = scratch.anchor;
+    SA.vah.clear();
     float tFir = joinFirst ? 0.5f : 0.0f;
     if (tFir == 0.0f) {
         P_fir = P[from]; C_fir = color(from); W_fir = weight(from);
@@ -578,17 +1470,18 @@ void Polyline::polylineApprox(const std::vector<glm::vec2>& P,
         segment(SA, opt, false, capLast, true);
     }
     
-    inopt.holder.push(vcore);
-    inopt.holder.push(vfadeo);
-    inopt.holder.push(vfadei);
-    inopt.holder.push(SA.vah);
+    holder.push(vcore);
+    holder.push(vfadeo);
+    holder.push(vfadei);
+    holder.push(SA.vah);
+    flush(false);
 }
 
 void Polyline::brushArc(VertexArrayHolder& tris,
                          const glm::vec2& center, const ofFloatColor& col,
                          float t, float r,
                          const glm::vec2& N_start, const glm::vec2& N_end,
-                         float wsr) {
+                         const Options& opt) {
     const float pi2 = glm::pi<float>() * 2.0f;
     
     float a_start = atan2f(N_start.y, N_start.x);
@@ -598,7 +1491,7 @@ void Polyline::brushArc(VertexArrayHolder& tris,
     if (diff > pi2) diff -= pi2;
     if (diff < 0.001f) return;
     
-    float dangle = getPljRoundDangle(t, r, wsr);
+    float dangle = getPljRoundDangle(t, r, opt);
     int steps = std::max(1, static_cast<int>(diff / dangle));
     
     ofFloatColor fadeCol = col;
@@ -628,242 +1521,170 @@ void Polyline::brushArc(VertexArrayHolder& tris,
     }
 }
 
-void Polyline::polylineExact(const std::vector<glm::vec2>& P,
-                              const std::vector<ofFloatColor>& C,
-                              const std::vector<float>& W,
+void Polyline::polylineExact(const PointView& P,
+                              const ColorView& C,
+                              const WidthView& W,
                               const Options& opt, InternalOpt& inopt,
                               int from, int to) {
-    bool capFirst = !inopt.noCapFirst;
-    bool capLast = !inopt.noCapLast;
-    
-    auto color = [&](int i) -> ofFloatColor {
-        return C[inopt.constColor ? 0 : i];
-    };
-    auto weight = [&](int i) -> float {
-        return W[inopt.constWeight ? 0 : i];
-    };
-    
     int n = to - from + 1;
     if (n < 2) return;
     
-    struct VtxInfo {
-        glm::vec2 pos;
-        float t, r;
-        ofFloatColor col;
-    };
-    
-    std::vector<VtxInfo> V(n);
+    VertexStream& V = scratch.vertices;
+    V.resize(n);
     for (int i = 0; i < n; i++) {
         int idx = from + i;
-        V[i].pos = P[idx];
-        V[i].col = color(idx);
-        determineTr(weight(idx), V[i].t, V[i].r, opt.worldToScreenRatio);
-        if (opt.feather && !opt.noFeatherAtCore)
-            V[i].r *= opt.feathering;
+        V.x[i] = P[idx].x;
+        V.y[i] = P[idx].y;
+        V.col[i] = C[inopt.constColor ? 0 : idx];
+        if (!inopt.constWeight) V.w[i] = W[idx];
     }
+    computeRadii(V, opt, inopt.constWeight, W[0]);
     
-    struct SegTan {
-        glm::vec2 N_top, N_bot;
-        bool degenerate = false;
-    };
-    std::vector<SegTan> seg(n - 1);
-    
-    for (int i = 0; i < n - 1; i++) {
-        glm::vec2 D = V[i+1].pos - V[i].pos;
-        float d = glm::length(D);
-        
-        float R1 = V[i].t + V[i].r;
-        float R2 = V[i+1].t + V[i+1].r;
-        
-        if (d < 0.001f || d < fabsf(R1 - R2)) {
-            seg[i].N_top = glm::vec2(0, 1);
-            seg[i].N_bot = glm::vec2(0, -1);
-            seg[i].degenerate = true;
-            continue;
-        }
-        
-        glm::vec2 u = D / d;
-        glm::vec2 nn(-u.y, u.x);
-        
-        float sinA = glm::clamp((R1 - R2) / d, -0.999f, 0.999f);
-        float cosA = sqrtf(1.0f - sinA * sinA);
-        
-        seg[i].N_top = sinA * u + cosA * nn;
-        seg[i].N_bot = sinA * u - cosA * nn;
-    }
-    
-    auto lineIsect = [](glm::vec2 p1, glm::vec2 d1,
-                        glm::vec2 p2, glm::vec2 d2,
-                        glm::vec2& out) -> bool {
-        float det = d1.x * d2.y - d1.y * d2.x;
-        if (fabsf(det) < 1e-8f) return false;
-        glm::vec2 dp = p2 - p1;
-        float t = (dp.x * d2.y - dp.y * d2.x) / det;
-        out = p1 + t * d1;
-        return true;
-    };
-
-    struct MiterInfo {
-        glm::vec2 core_inner, fade_inner;
-        bool valid = false;
-        bool top_is_inner = false;
-    };
-    std::vector<MiterInfo> M(n);
-
-    for (int i = 1; i < n - 1; i++) {
-        if (seg[i-1].degenerate || seg[i].degenerate) continue;
-
-        auto& ps = seg[i-1];
-        auto& ns = seg[i];
-
-        glm::vec2 d_prev = V[i].pos - V[i-1].pos;
-        glm::vec2 d_next = V[i+1].pos - V[i].pos;
-        float cross = d_prev.x * d_next.y - d_prev.y * d_next.x;
-        M[i].top_is_inner = (cross > 0);
-
-        glm::vec2 N_inner_prev = M[i].top_is_inner ? ps.N_top : ps.N_bot;
-        glm::vec2 N_inner_next = M[i].top_is_inner ? ns.N_top : ns.N_bot;
-
-        auto edgeDir = [&](int si, glm::vec2 N) -> glm::vec2 {
-            return (V[si+1].pos + V[si+1].t * N) - (V[si].pos + V[si].t * N);
-        };
-        auto edgeDirR = [&](int si, glm::vec2 N) -> glm::vec2 {
-            float R0 = V[si].t + V[si].r;
-            float R1 = V[si+1].t + V[si+1].r;
-            return (V[si+1].pos + R1 * N) - (V[si].pos + R0 * N);
-        };
-
-        float maxLen = 3.0f * (V[i].t + V[i].r);
-
-        glm::vec2 pA = V[i].pos + V[i].t * N_inner_prev;
-        glm::vec2 dA = edgeDir(i-1, N_inner_prev);
-        glm::vec2 pB = V[i].pos + V[i].t * N_inner_next;
-        glm::vec2 dB = edgeDir(i, N_inner_next);
-        glm::vec2 isect;
-        if (lineIsect(pA, dA, pB, dB, isect)) {
-            float dist = glm::length(isect - V[i].pos);
-            glm::vec2 avgInner = N_inner_prev + N_inner_next;
-            float side = glm::dot(isect - V[i].pos, avgInner);
-            if (side > 0 && dist < maxLen) {
-                M[i].core_inner = isect;
-                M[i].valid = true;
-
-                float R = V[i].t + V[i].r;
-                glm::vec2 fpA = V[i].pos + R * N_inner_prev;
-                glm::vec2 fdA = edgeDirR(i-1, N_inner_prev);
-                glm::vec2 fpB = V[i].pos + R * N_inner_next;
-                glm::vec2 fdB = edgeDirR(i, N_inner_next);
-                if (!lineIsect(fpA, fdA, fpB, fdB, M[i].fade_inner)) {
-                    glm::vec2 dir = glm::normalize(isect - V[i].pos);
-                    M[i].fade_inner = V[i].pos + R * dir;
-                }
-            }
-        }
-    }
-
-    VertexArrayHolder tris;
-    tris.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLES);
+    polylineExact(V, 0, n, opt, 0, n);
+}
 
-    auto drawDisc = [&](const VtxInfo& v) {
+void Polyline::polylineExact(const VertexStream& VS, int first, int n, const Options& opt,
+                             int begin, int end) {
+    if (n < 2) return;
+    
+    const float* X = VS.x.data() + first;
+    const float* Y = VS.y.data() + first;
+    const float* Tv = VS.t.data() + first;
+    const float* Rv = VS.r.data() + first;
+    const ofFloatColor* Col = VS.col.data() + first;
+    auto pos = [&](int i) { return glm::vec2(X[i], Y[i]); };
+    
+    // Segment tangents of the disc hull, then inner miters at every joint
+    auto& ntx = scratch.ntx;  auto& nty = scratch.nty;
+    auto& nbx = scratch.nbx;  auto& nby = scratch.nby;
+    auto& degenerate = scratch.degenerate;
+    ntx.resize(n); nty.resize(n); nbx.resize(n); nby.resize(n);
+    degenerate.resize(n);
+    batch::segmentTangents(X, Y, Tv, Rv, n,
+                           ntx.data(), nty.data(), nbx.data(), nby.data(), degenerate.data());
+    
+    auto& coreX = scratch.coreX;  auto& coreY = scratch.coreY;
+    auto& fadeX = scratch.fadeX;  auto& fadeY = scratch.fadeY;
+    auto& miterValid = scratch.miterValid;
+    auto& topInner = scratch.topInner;
+    coreX.resize(n); coreY.resize(n); fadeX.resize(n); fadeY.resize(n);
+    miterValid.resize(n); topInner.resize(n);
+    batch::innerMiters(X, Y, Tv, Rv, ntx.data(), nty.data(), nbx.data(), nby.data(),
+                       degenerate.data(), n,
+                       coreX.data(), coreY.data(), fadeX.data(), fadeY.data(),
+                       miterValid.data(), topInner.data());
+    
+    auto nTop = [&](int i) { return glm::vec2(ntx[i], nty[i]); };
+    auto nBot = [&](int i) { return glm::vec2(nbx[i], nby[i]); };
+    auto coreInner = [&](int i) { return glm::vec2(coreX[i], coreY[i]); };
+    auto fadeInner = [&](int i) { return glm::vec2(fadeX[i], fadeY[i]); };
+
+    // Triangles go straight into the holder, which the constructor sized
+    VertexArrayHolder& tris = holder;
+
+    auto drawDisc = [&](int i) {
         const float pi2 = glm::pi<float>() * 2.0f;
-        float dangle = getPljRoundDangle(v.t, v.r, opt.worldToScreenRatio);
+        glm::vec2 c = pos(i);
+        float t = Tv[i];
+        const ofFloatColor& col = Col[i];
+        float dangle = getPljRoundDangle(t, Rv[i], opt);
         int steps = std::max(8, static_cast<int>(pi2 / dangle));
-        float R = v.t + v.r;
+        float R = t + Rv[i];
         for (int j = 0; j < steps; j++) {
             float a1 = pi2 * j / steps;
             float a2 = pi2 * (j + 1) / steps;
             glm::vec2 d1(cosf(a1), sinf(a1));
             glm::vec2 d2(cosf(a2), sinf(a2));
-            glm::vec2 p1 = v.pos + v.t * d1;
-            glm::vec2 p2 = v.pos + v.t * d2;
-            tris.push3(v.pos, p1, p2, v.col, v.col, v.col);
-            glm::vec2 f1 = v.pos + R * d1;
-            glm::vec2 f2 = v.pos + R * d2;
-            tris.push(p1, v.col);
-            tris.push(p2, v.col);
-            tris.pushF(f1, v.col);
-            tris.push(p2, v.col);
-            tris.pushF(f1, v.col);
-            tris.pushF(f2, v.col);
+            glm::vec2 p1 = c + t * d1;
+            glm::vec2 p2 = c + t * d2;
+            tris.push3(c, p1, p2, col, col, col);
+            glm::vec2 f1 = c + R * d1;
+            glm::vec2 f2 = c + R * d2;
+            tris.push(p1, col);
+            tris.push(p2, col);
+            tris.pushF(f1, col);
+            tris.push(p2, col);
+            tris.pushF(f1, col);
+            tris.pushF(f2, col);
         }
     };
 
     auto drawSegBody = [&](int i) {
-        if (seg[i].degenerate) {
-            drawDisc(V[i+1]);
+        if (degenerate[i]) {
+            drawDisc(i + 1);
             return;
         }
-        auto& v1 = V[i];
-        auto& v2 = V[i+1];
-        auto& st = seg[i];
-
-        glm::vec2 T1t = v1.pos + v1.t * st.N_top;
-        glm::vec2 T1b = v1.pos + v1.t * st.N_bot;
-        glm::vec2 T2t = v2.pos + v2.t * st.N_top;
-        glm::vec2 T2b = v2.pos + v2.t * st.N_bot;
-
-        float R1 = v1.t + v1.r;
-        float R2 = v2.t + v2.r;
-        glm::vec2 F1t = v1.pos + R1 * st.N_top;
-        glm::vec2 F1b = v1.pos + R1 * st.N_bot;
-        glm::vec2 F2t = v2.pos + R2 * st.N_top;
-        glm::vec2 F2b = v2.pos + R2 * st.N_bot;
-
-        if (i > 0 && M[i].valid) {
-            if (M[i].top_is_inner) { T1t = M[i].core_inner; F1t = M[i].fade_inner; }
-            else                   { T1b = M[i].core_inner; F1b = M[i].fade_inner; }
-        }
-        if (i < n-2 && M[i+1].valid) {
-            if (M[i+1].top_is_inner) { T2t = M[i+1].core_inner; F2t = M[i+1].fade_inner; }
-            else                     { T2b = M[i+1].core_inner; F2b = M[i+1].fade_inner; }
+        glm::vec2 p1 = pos(i), p2 = pos(i + 1);
+        const ofFloatColor& c1 = Col[i];
+        const ofFloatColor& c2 = Col[i + 1];
+        glm::vec2 Nt = nTop(i), Nb = nBot(i);
+
+        glm::vec2 T1t = p1 + Tv[i] * Nt;
+        glm::vec2 T1b = p1 + Tv[i] * Nb;
+        glm::vec2 T2t = p2 + Tv[i+1] * Nt;
+        glm::vec2 T2b = p2 + Tv[i+1] * Nb;
+
+        float R1 = Tv[i] + Rv[i];
+        float R2 = Tv[i+1] + Rv[i+1];
+        glm::vec2 F1t = p1 + R1 * Nt;
+        glm::vec2 F1b = p1 + R1 * Nb;
+        glm::vec2 F2t = p2 + R2 * Nt;
+        glm::vec2 F2b = p2 + R2 * Nb;
+
+        if (i > 0 && miterValid[i]) {
+            if (topInner[i]) { T1t = coreInner(i); F1t = fadeInner(i); }
+            else             { T1b = coreInner(i); F1b = fadeInner(i); }
+        }
+        if (i < n-2 && miterValid[i+1]) {
+            if (topInner[i+1]) { T2t = coreInner(i+1); F2t = fadeInner(i+1); }
+            else               { T2b = coreInner(i+1); F2b = fadeInner(i+1); }
         }
 
-        tris.push3(T1t, T2t, T2b, v1.col, v2.col, v2.col);
-        tris.push3(T1t, T2b, T1b, v1.col, v2.col, v1.col);
+        tris.push3(T1t, T2t, T2b, c1, c2, c2);
+        tris.push3(T1t, T2b, T1b, c1, c2, c1);
 
-        tris.push(T1t, v1.col);  tris.push(T2t, v2.col);  tris.pushF(F1t, v1.col);
-        tris.push(T2t, v2.col);  tris.pushF(F1t, v1.col); tris.pushF(F2t, v2.col);
+        tris.push(T1t, c1);  tris.push(T2t, c2);  tris.pushF(F1t, c1);
+        tris.push(T2t, c2);  tris.pushF(F1t, c1); tris.pushF(F2t, c2);
 
-        tris.push(T1b, v1.col);  tris.push(T2b, v2.col);  tris.pushF(F1b, v1.col);
-        tris.push(T2b, v2.col);  tris.pushF(F1b, v1.col); tris.pushF(F2b, v2.col);
+        tris.push(T1b, c1);  tris.push(T2b, c2);  tris.pushF(F1b, c1);
+        tris.push(T2b, c2);  tris.pushF(F1b, c1); tris.pushF(F2b, c2);
     };
 
     auto drawJointFill = [&](int i) {
-        auto& v = V[i];
-        auto& ps = seg[i-1];
-        auto& ns = seg[i];
+        glm::vec2 c = pos(i);
+        float t = Tv[i];
+        const ofFloatColor& col = Col[i];
 
         // Fill both-side gaps (center to tangent points)
-        glm::vec2 pt1 = v.pos + v.t * ps.N_top;
-        glm::vec2 pt2 = v.pos + v.t * ns.N_top;
-        tris.push3(v.pos, pt1, pt2, v.col, v.col, v.col);
+        glm::vec2 pt1 = c + t * nTop(i-1);
+        glm::vec2 pt2 = c + t * nTop(i);
+        tris.push3(c, pt1, pt2, col, col, col);
 
-        glm::vec2 pb1 = v.pos + v.t * ps.N_bot;
-        glm::vec2 pb2 = v.pos + v.t * ns.N_bot;
-        tris.push3(v.pos, pb1, pb2, v.col, v.col, v.col);
+        glm::vec2 pb1 = c + t * nBot(i-1);
+        glm::vec2 pb2 = c + t * nBot(i);
+        tris.push3(c, pb1, pb2, col, col, col);
 
         // Miter connecting triangle (tangent_prev → miter → tangent_next)
-        if (M[i].valid) {
-            glm::vec2 ip = M[i].top_is_inner ? (v.pos + v.t * ps.N_top) : (v.pos + v.t * ps.N_bot);
-            glm::vec2 in_ = M[i].top_is_inner ? (v.pos + v.t * ns.N_top) : (v.pos + v.t * ns.N_bot);
-            tris.push3(ip, M[i].core_inner, in_, v.col, v.col, v.col);
+        if (miterValid[i]) {
+            glm::vec2 ip = topInner[i] ? pt1 : pb1;
+            glm::vec2 in_ = topInner[i] ? pt2 : pb2;
+            tris.push3(ip, coreInner(i), in_, col, col, col);
         }
     };
 
     // Draw in stroke order: segment → joint → disc (disc on top to cover gradient bleed)
-    for (int i = 0; i < n; i++) {
+    for (int i = begin; i < end; i++) {
         if (i > 0) {
             drawSegBody(i - 1);
         }
 
-        if (i > 0 && i < n - 1 && !seg[i-1].degenerate && !seg[i].degenerate) {
+        if (i > 0 && i < n - 1 && !degenerate[i-1] && !degenerate[i]) {
             drawJointFill(i);
         }
 
-        drawDisc(V[i]);
+        drawDisc(i);
+        flush(false);
     }
-
-    inopt.holder.push(tris);
 }
 
 // ============================================================================
@@ -933,12 +1754,12 @@ void Polyline::segment(StAnchor& SA, const Options& opt,
         SL[1].degenT = false;
     }
     
-    segmentLate(opt, P, C, SL, SA.vah, capStart, capEnd, core);
+    segmentLate(opt, P, C, SL, SA.vah, SA.strip, capStart, capEnd, core);
 }
 
 void Polyline::segmentLate(const Options& opt,
                            glm::vec2* P, ofFloatColor* C, StPolyline* SL,
-                           VertexArrayHolder& tris,
+                           VertexArrayHolder& tris, VertexArrayHolder& strip,
                            const glm::vec2& cap1, const glm::vec2& cap2, bool core) {
     tris.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLES);
     
@@ -997,10 +1818,12 @@ void Polyline::segmentLate(const Options& opt,
         if (glm::length(cur_cap) < 0.001f) continue;
         
         if (SL[j].djoint == static_cast<char>(CapStyle::Round)) {
-            VertexArrayHolder cap;
+            VertexArrayHolder& cap = strip;
+            cap.clear();
             cap.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLE_STRIP);
             glm::vec2 O = P[j];
-            float dangle = getPljRoundDangle(SL[j].t, SL[j].r, opt.worldToScreenRatio);
+            float dangle = getPljRoundDangle(SL[j].t, SL[j].r, opt);
+            cap.reserve(16 + 4 * (static_cast<size_t>(glm::pi<float>() / dangle) + 2));
             
             glm::vec2 bRcap = SL[j].bR;
             util::followSigns(bRcap, j == 0 ? cap1 : cap2);
@@ -1036,8 +1859,10 @@ void Polyline::segmentLate(const Options& opt,
             tris.push(cap);
         } else if (SL[j].djoint == static_cast<char>(CapStyle::Rect) ||
                    SL[j].djoint == static_cast<char>(CapStyle::Square)) {
-            VertexArrayHolder cap;
+            VertexArrayHolder& cap = strip;
+            cap.clear();
             cap.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLE_STRIP);
+            cap.reserve(6);
             
             glm::vec2 Pj, Pjr, Pjc, Pk, Pkr, Pkc;
             if (j == 0) {
@@ -1368,11 +2193,11 @@ void Polyline::anchorCap(const Options& opt,
         glm::vec2 cur_cap = (i == 0) ? cap1 : cap2;
         if (glm::length(cur_cap) < 0.001f) continue;
         
-        VertexArrayHolder cap;
+        VertexArrayHolder cap(opt.getMemoryResource());
         cap.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLES);
         
         if (SL[i].djoint == static_cast<char>(CapStyle::Round)) {
-            VertexArrayHolder strip;
+            VertexArrayHolder strip(opt.getMemoryResource());
             strip.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLE_STRIP);
             
             ofFloatColor C2 = C[i]; C2.a = 0.0f;
@@ -1380,7 +2205,7 @@ void Polyline::anchorCap(const Options& opt,
             glm::vec2 app_P = O + SL[i].T;
             glm::vec2 bRcap = SL[i].bR;
             util::followSigns(bRcap, cur_cap);
-            float dangle = getPljRoundDangle(SL[i].t, SL[i].r, opt.worldToScreenRatio);
+            float dangle = getPljRoundDangle(SL[i].t, SL[i].r, opt);
             
             // Core arc
             vectorsToArc(strip, O, C[i], C[i],
@@ -1523,11 +2348,11 @@ void Polyline::anchorLate(const Options& opt,
             tris.push3(P2, P5, P1, C[1], C[1], C[1]);
             break;
         case static_cast<char>(JointStyle::Round): {
-            VertexArrayHolder strip;
+            VertexArrayHolder strip(opt.getMemoryResource());
             strip.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLE_STRIP);
             vectorsToArc(strip, P_1, C[1], C[1],
                          SL[1].T1, SL[1].T,
-                         getPljRoundDangle(SL[1].t, SL[1].r, opt.worldToScreenRatio),
+                         getPljRoundDangle(SL[1].t, SL[1].r, opt),
                          SL[1].t, 0.0f, false, P1,
                          glm::vec2(0), 0, true);
             tris.push(strip);
@@ -1632,12 +2457,12 @@ void Polyline::anchorLate(const Options& opt,
                 tris.pushF(P5r, C[1]);
                 break;
             case static_cast<char>(JointStyle::Round): {
-                VertexArrayHolder strip;
+                VertexArrayHolder strip(opt.getMemoryResource());
                 strip.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLE_STRIP);
                 ofFloatColor C2 = C[1]; C2.a = 0.0f;
                 vectorsToArc(strip, P_1, C[1], C2,
                              SL[1].T1, SL[1].T,
-                             getPljRoundDangle(SL[1].t, SL[1].r, opt.worldToScreenRatio),
+                             getPljRoundDangle(SL[1].t, SL[1].r, opt),
                              SL[1].t, SL[1].t + SL[1].r, false, P_1,
                              glm::vec2(0), 0, false);
                 tris.push(strip);
@@ -1759,26 +2584,351 @@ void Polyline::vectorsToArc(VertexArrayHolder& hold,
 Segment::Segment(const glm::vec2& p1, const glm::vec2& p2,
                  const ofFloatColor& c1, const ofFloatColor& c2,
                  float w1, float w2,
-                 const Options& opt) {
-    std::vector<glm::vec2> points = { p1, p2 };
-    std::vector<ofFloatColor> colors = { c1, c2 };
-    std::vector<float> widths = { w1, w2 };
-    Polyline poly(points, colors, widths, opt);
-    holder = poly.holder;
+                 const Options& opt)
+    : holder(opt.memoryResource), line(opt.memoryResource) {
+    rebuild(p1, p2, c1, c2, w1, w2, opt);
 }
 
 Segment::Segment(const glm::vec2& p1, const glm::vec2& p2,
                  const ofFloatColor& color, float width,
-                 const Options& opt) {
-    std::vector<glm::vec2> points = { p1, p2 };
-    Polyline poly(points, color, width, opt);
-    holder = poly.holder;
+                 const Options& opt)
+    : holder(opt.memoryResource), line(opt.memoryResource) {
+    rebuild(p1, p2, color, width, opt);
+}
+
+void Segment::rebuild(const glm::vec2& p1, const glm::vec2& p2,
+                      const ofFloatColor& c1, const ofFloatColor& c2,
+                      float w1, float w2,
+                      const Options& opt) {
+    const glm::vec2 points[] = { p1, p2 };
+    const ofFloatColor colors[] = { c1, c2 };
+    const float widths[] = { w1, w2 };
+    // Lend the holder's storage to the polyline for the rebuild and take it back
+    line.holder = std::move(holder);
+    line.rebuild(PointView(points, 2), ColorView(colors, 2), WidthView(widths, 2), opt);
+    holder = std::move(line.holder);
+}
+
+void Segment::rebuild(const glm::vec2& p1, const glm::vec2& p2,
+                      const ofFloatColor& color, float width,
+                      const Options& opt) {
+    const glm::vec2 points[] = { p1, p2 };
+    line.holder = std::move(holder);
+    line.rebuild(PointView(points, 2), color, width, opt);
+    holder = std::move(line.holder);
+}
+
+// ============================================================================
+// Marker Batch
+// ============================================================================
+
+namespace {
+
+// Unit circles, one per level of detail, each closed by repeating its first
+// direction. A disc takes the first level with at least the steps it needs.
+class DiscTemplates {
+public:
+    DiscTemplates() {
+        const float pi2 = glm::pi<float>() * 2.0f;
+        for (int l = 0; l < levelCount; l++) {
+            int steps = levels[l];
+            dirs[l].resize(steps + 1);
+            for (int j = 0; j < steps; j++) {
+                float a = pi2 * j / steps;
+                dirs[l][j] = glm::vec2(cosf(a), sinf(a));
+            }
+            dirs[l][steps] = dirs[l][0];
+        }
+    }
+    
+    const std::vector<glm::vec2>& forSteps(int steps) const {
+        int l = 0;
+        while (l < levelCount - 1 && levels[l] < steps) l++;
+        return dirs[l];
+    }
+    
+private:
+    static constexpr int levelCount = 11;
+    static constexpr int levels[levelCount] = { 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256 };
+    std::vector<glm::vec2> dirs[levelCount];
+};
+
+const DiscTemplates& discTemplates() {
+    static const DiscTemplates templates;
+    return templates;
+}
+
+} // namespace
+
+// Core and fade radii of a round joint of a stroke 2 * radius wide
+struct MarkerBatch::Shape {
+    float t, R;
+    int steps;
+    float alpha;
+};
+
+MarkerBatch::Shape MarkerBatch::shape(float radius, const Options& opt, float feather) {
+    Shape d;
+    float r = 0;
+    float width = 2.0f * radius;
+    Polyline::determineTr(width, d.t, r, opt.worldToScreenRatio);
+    r *= feather;
+    d.R = d.t + r;
+    // Steps that keep the outer edge within a quarter pixel of the circle
+    float screenR = d.R * opt.worldToScreenRatio;
+    float halfStep = acosf(std::max(1.0f - 0.25f / std::max(screenR, 0.01f), -1.0f));
+    d.steps = static_cast<int>(std::ceil(glm::pi<float>() / halfStep / opt.arcStep));
+    float px = width * opt.worldToScreenRatio;
+    d.alpha = px < 1.0f ? std::max(px, 0.0f) : 1.0f;
+    return d;
+}
+
+void MarkerBatch::add(const PointView& centers, const WidthView& radii, const ColorView& colors,
+                      const Options& opt) {
+    if (radii.empty() || colors.empty()) return;
+    size_t n = centers.size();
+    if (radii.size() != 1) n = std::min(n, radii.size());
+    if (colors.size() != 1) n = std::min(n, colors.size());
+    
+    float feather = (opt.feather && !opt.noFeatherAtCore) ? opt.feathering : 1.0f;
+    const DiscTemplates& templates = discTemplates();
+    bool constRadius = radii.size() == 1;
+    Shape disc = shape(radii[0], opt, feather);
+    
+    for (size_t i = 0; i < n; i++) {
+        if (!constRadius) disc = shape(radii[i], opt, feather);
+        glm::vec2 c = centers[i];
+        float R = disc.R;
+        if (opt.clip && (c.x + R < opt.clipRect.getLeft() || c.x - R > opt.clipRect.getRight() ||
+                         c.y + R < opt.clipRect.getTop() || c.y - R > opt.clipRect.getBottom())) {
+            continue;
+        }
+        
+        ofFloatColor col = colors[colors.size() == 1 ? 0 : i];
+        col.a *= disc.alpha;
+        ofFloatColor fade = col;
+        fade.a = 0;
+        
+        // Written in place rather than pushed: a core fan triangle and a fade
+        // quad per step, as Polyline's discs
+        const std::vector<glm::vec2>& dir = templates.forSteps(disc.steps);
+        size_t steps = dir.size() - 1;
+        size_t base = holder.vertices.size();
+        holder.vertices.resize(base + 9 * steps);
+        holder.colors.resize(base + 9 * steps, col);
+        glm::vec3* v = holder.vertices.data() + base;
+        ofFloatColor* vc = holder.colors.data() + base;
+        float t = disc.t;
+        for (size_t j = 0; j < steps; j++, v += 9, vc += 9) {
+            glm::vec2 p1 = c + t * dir[j], p2 = c + t * dir[j + 1];
+            glm::vec2 f1 = c + R * dir[j], f2 = c + R * dir[j + 1];
+            v[0] = glm::vec3(c, 0); v[1] = glm::vec3(p1, 0); v[2] = glm::vec3(p2, 0);
+            v[3] = glm::vec3(p1, 0); v[4] = glm::vec3(p2, 0); v[5] = glm::vec3(f1, 0);
+            v[6] = glm::vec3(p2, 0); v[7] = glm::vec3(f1, 0); v[8] = glm::vec3(f2, 0);
+            vc[5] = fade; vc[7] = fade; vc[8] = fade;
+        }
+        discs++;
+    }
+}
+
+void MarkerBatch::add(const glm::vec2& center, float radius, const ofFloatColor& color,
+                      const Options& opt) {
+    add(PointView(&center, 1), WidthView(&radius, 1), ColorView(&color, 1), opt);
+}
+
+size_t MarkerBatch::estimateVertexCount(size_t count, const WidthView& radii, const Options& opt) {
+    if (radii.empty()) return 0;
+    float feather = (opt.feather && !opt.noFeatherAtCore) ? opt.feathering : 1.0f;
+    const DiscTemplates& templates = discTemplates();
+    auto vertices = [&](float radius) {
+        return 9 * (templates.forSteps(shape(radius, opt, feather).steps).size() - 1);
+    };
+    if (radii.size() == 1) return count * vertices(radii[0]);
+    size_t total = 0;
+    for (size_t i = 0; i < std::min(count, radii.size()); i++) {
+        total += vertices(radii[i]);
+    }
+    return total;
+}
+
+// ============================================================================
+// Streaming
+// ============================================================================
+
+namespace {
+
+// Spline samples gathered before the window is tessellated and shifted
+constexpr int streamChunk = 1024;
+
+} // namespace
+
+PolylineStream::PolylineStream(VertexSink& sink, const Options& opt)
+    : opt(opt), own(opt.memoryResource), line(own) {
+    line.sink = &sink;
+}
+
+PolylineStream::PolylineStream(Polyline& target, const Options& opt)
+    : opt(opt), line(target) {}
+
+void PolylineStream::add(const PointView& points, const ColorView& colors,
+                         const WidthView& widths) {
+    bool constColor = colors.size() == 1;
+    bool constWidth = widths.size() == 1;
+    for (size_t i = 0; i < points.size(); i++) {
+        add(points[i], colors[constColor ? 0 : i], widths[constWidth ? 0 : i]);
+    }
+}
+
+void PolylineStream::add(const glm::vec2& point, const ofFloatColor& color, float width) {
+    pointCount++;
+    if (opt.smoothing <= 0) {
+        push(point, color, width);
+        return;
+    }
+    
+    for (int j = 0; j < 3; j++) {
+        recentPoints[j] = recentPoints[j + 1];
+        recentColors[j] = recentColors[j + 1];
+        recentWidths[j] = recentWidths[j + 1];
+    }
+    recentPoints[3] = point;
+    recentColors[3] = color;
+    recentWidths[3] = width;
+    
+    // The span two points back now has all four of its control points
+    if (pointCount >= 3) smoothSpan(1);
+}
+
+void PolylineStream::smoothSpan(int j) {
+    // recentPoints[j] starts the span; the neighbours are clamped at the ends
+    // of the stroke, as in Polyline::smoothVertices
+    bool atStart = static_cast<long long>(pointCount) - 4 + j == 0;
+    const glm::vec2& p0 = recentPoints[atStart ? j : j - 1];
+    const glm::vec2& p1 = recentPoints[j];
+    const glm::vec2& p2 = recentPoints[j + 1];
+    const glm::vec2& p3 = recentPoints[std::min(3, j + 2)];
+    const ofFloatColor& c1 = recentColors[j];
+    const ofFloatColor& c2 = recentColors[j + 1];
+    float w1 = recentWidths[j];
+    float w2 = recentWidths[j + 1];
+    
+    int steps = opt.smoothing;
+    float tolerance = opt.getSmoothingTolerance();
+    if (tolerance > 0) {
+        steps = util::smoothingSubdivisions(p0, p1, p2, p3, tolerance / opt.worldToScreenRatio,
+                                            opt.smoothing);
+    }
+    util::CatmullRomStepper step(p0, p1, p2, p3, steps);
+    for (int k = 0; k < steps; k++) {
+        float t = (float)k / steps;
+        glm::vec2 pos = step.next();
+        // Equal ends stay exact, matching the constant color/width tessellation
+        push(pos, c1 == c2 ? c1 : util::colorBetween(c1, c2, t),
+             w1 == w2 ? w1 : w1 * (1.0f - t) + w2 * t);
+    }
+}
+
+void PolylineStream::push(const glm::vec2& point, const ofFloatColor& color, float width) {
+    Polyline::VertexStream& V = line.scratch.vertices;
+    int n = V.size();
+    V.resize(n + 1);
+    V.x[n] = point.x;
+    V.y[n] = point.y;
+    V.col[n] = color;
+    V.w[n] = width;
+    if (n + 1 >= streamChunk) drain(false);
+}
+
+void PolylineStream::drain(bool end) {
+    Polyline::VertexStream& V = line.scratch.vertices;
+    int n = V.size();
+    if (n < 2) {
+        V.resize(0);
+        return;
+    }
+    
+    // A vertex's triangles depend on its neighbours' tangents and miters, so
+    // the last one waits for the next chunk and two stay behind as context
+    Polyline::computeRadii(V, opt, false, 0.0f);
+    line.polylineExact(V, 0, n, opt, started ? 2 : 0, end ? n : n - 1);
+    if (end) {
+        V.resize(0);
+        started = false;
+    } else {
+        V.keepLast(3);
+        started = true;
+    }
+}
+
+void PolylineStream::finish() {
+    if (opt.smoothing > 0 && pointCount >= 2) {
+        smoothSpan(2);
+        push(recentPoints[3], recentColors[3], recentWidths[3]);
+    }
+    drain(true);
+    line.flush(true);
+    pointCount = 0;
+}
+
+// ============================================================================
+// Async
+// ============================================================================
+
+PolylineSlot::PolylineSlot(std::pmr::memory_resource* mr)
+    : buffers{ Polyline(mr), Polyline(mr), Polyline(mr) } {}
+
+void PolylineSlot::publish() {
+    // Release the finished buffer to the reader and take the spare one back
+    writeIndex = middle.exchange(writeIndex | fresh, std::memory_order_acq_rel) & 3;
+}
+
+const Polyline& PolylineSlot::front() {
+    if (middle.load(std::memory_order_relaxed) & fresh) {
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & 3;
+    }
+    return buffers[readIndex];
+}
+
+std::future<Polyline> tessellateAsync(std::vector<glm::vec2> points,
+                                      std::vector<ofFloatColor> colors,
+                                      std::vector<float> widths,
+                                      Options opt) {
+    return std::async(std::launch::async,
+                      [points = std::move(points), colors = std::move(colors),
+                       widths = std::move(widths), opt = std::move(opt)] {
+        return Polyline(points, colors, widths, opt);
+    });
+}
+
+std::future<void> tessellateAsync(PolylineSlot& slot,
+                                  std::vector<glm::vec2> points,
+                                  std::vector<ofFloatColor> colors,
+                                  std::vector<float> widths,
+                                  Options opt) {
+    return std::async(std::launch::async,
+                      [&slot, points = std::move(points), colors = std::move(colors),
+                       widths = std::move(widths), opt = std::move(opt)] {
+        slot.back().rebuild(points, colors, widths, opt);
+        slot.publish();
+    });
 }
 
 // ============================================================================
 // Renderer with shader support
 // ============================================================================
 
+namespace {
+
+int glPrimitive(int glmode) {
+    switch (glmode) {
+        case VertexArrayHolder::DRAW_TRIANGLE_STRIP: return GL_TRIANGLE_STRIP;
+        case VertexArrayHolder::DRAW_LINES: return GL_LINES;
+        default: return GL_TRIANGLES;
+    }
+}
+
+} // namespace
+
 Renderer::Renderer() {}
 Renderer::~Renderer() {}
 
@@ -1798,7 +2948,16 @@ void Renderer::end() {
 
 void Renderer::draw(const VertexArrayHolder& holder) {
     if (holder.vertices.empty()) return;
-    holder.toMesh().draw();
+    if (capture::enabled()) capture::draw(holder);
+    upload(holder);
+}
+
+void Renderer::upload(const VertexArrayHolder& holder) {
+    // Upload straight from the holder's arrays instead of going through an ofMesh copy
+    int count = holder.getCount();
+    vbo.setVertexData(holder.vertices.data(), count, GL_STREAM_DRAW);
+    vbo.setColorData(holder.colors.data(), count, GL_STREAM_DRAW);
+    vbo.draw(glPrimitive(holder.glmode), 0, count);
 }
 
 void Renderer::draw(const Polyline& polyline) {
@@ -1809,6 +2968,420 @@ void Renderer::draw(const Segment& segment) {
     draw(segment.holder);
 }
 
+void Renderer::draw(const MarkerBatch& markers) {
+    draw(markers.holder);
+}
+
+void Renderer::draw(PolylineSlot& slot) {
+    draw(slot.front());
+}
+
+namespace {
+
+// Fixed, so one InstancedStroke's VBO works with every Renderer's shader;
+// openFrameworks binds its default attributes to 0-3
+enum InstanceAttribute { instanceAxesLocation = 4, instanceOffsetLocation = 5, instanceTintLocation = 6 };
+
+#ifdef TARGET_OPENGLES
+#define VASE_INSTANCE_GLSL_VERSION "#version 300 es\nprecision highp float;\n"
+#else
+#define VASE_INSTANCE_GLSL_VERSION "#version 150\n"
+#endif
+
+// Applies each vertex's instance transform and tint; the stroke's own
+// fade is already in its vertex colors
+const char* instanceVertexShader = VASE_INSTANCE_GLSL_VERSION R"(
+uniform mat4 modelViewProjectionMatrix;
+
+in vec4 position;
+in vec4 color;
+in vec4 instanceAxes;    // xy: axisX, zw: axisY
+in vec2 instanceOffset;
+in vec4 instanceTint;
+
+out vec4 vColor;
+
+void main() {
+    vec2 p = instanceAxes.xy * position.x + instanceAxes.zw * position.y + instanceOffset;
+    vColor = color * instanceTint;
+    gl_Position = modelViewProjectionMatrix * vec4(p, position.z, 1.0);
+}
+)";
+
+const char* instanceFragmentShader = VASE_INSTANCE_GLSL_VERSION R"(
+in vec4 vColor;
+out vec4 fragColor;
+
+void main() {
+    fragColor = vColor;
+}
+)";
+
+} // namespace
+
+bool Renderer::setupInstancing() {
+    if (instancingState != 0) return instancingState > 0;
+    instancingState = -1;
+    // Attribute divisors need GL 3.3 or GLES 3
+    if (!ofIsGLProgrammableRenderer() || ofGetGLRenderer()->getGLVersionMajor() < 3) {
+        ofLogNotice("ofxVase") << "Instancing needs a GL 3 or GLES 3 programmable renderer; "
+                               << "using the CPU fallback";
+        return false;
+    }
+    if (!instanceShader.setupShaderFromSource(GL_VERTEX_SHADER, instanceVertexShader) ||
+        !instanceShader.setupShaderFromSource(GL_FRAGMENT_SHADER, instanceFragmentShader)) {
+        ofLogError("ofxVase") << "Instancing shader failed to compile; using the CPU fallback";
+        return false;
+    }
+    instanceShader.bindDefaults();
+    instanceShader.bindAttribute(instanceAxesLocation, "instanceAxes");
+    instanceShader.bindAttribute(instanceOffsetLocation, "instanceOffset");
+    instanceShader.bindAttribute(instanceTintLocation, "instanceTint");
+    if (!instanceShader.linkProgram()) {
+        ofLogError("ofxVase") << "Instancing shader failed to link; using the CPU fallback";
+        return false;
+    }
+    instancingState = 1;
+    return true;
+}
+
+bool Renderer::isInstancing() {
+    return instancingAllowed && setupInstancing();
+}
+
+void Renderer::drawInstanced(InstancedStroke& stroke, const Instance* instances, size_t count) {
+    const VertexArrayHolder& holder = stroke.holder;
+    if (holder.vertices.empty() || count == 0) return;
+    // Recorded as the instanced draw, whichever path takes it
+    if (capture::enabled()) capture::draw(holder.glmode, holder.vertices.size() * count);
+    if (!isInstancing()) {
+        transformInstances(holder, instances, count, instanceBatch);
+        upload(instanceBatch);
+        return;
+    }
+    
+    // ofVbo attributes can't have an offset into a struct, so each is packed on its own
+    instanceAxes.resize(count * 4);
+    instanceOffsets.resize(count * 2);
+    instanceTints.resize(count * 4);
+    for (size_t i = 0; i < count; i++) {
+        const Instance& in = instances[i];
+        float* axes = &instanceAxes[i * 4];
+        axes[0] = in.axisX.x; axes[1] = in.axisX.y;
+        axes[2] = in.axisY.x; axes[3] = in.axisY.y;
+        instanceOffsets[i * 2] = in.offset.x;
+        instanceOffsets[i * 2 + 1] = in.offset.y;
+        float* tint = &instanceTints[i * 4];
+        tint[0] = in.tint.r; tint[1] = in.tint.g; tint[2] = in.tint.b; tint[3] = in.tint.a;
+    }
+    
+    int vertices = holder.getCount();
+    int instanceCount = static_cast<int>(count);
+    ofVbo& vbo = stroke.vbo;
+    if (!stroke.uploaded) {
+        vbo.setVertexData(holder.vertices.data(), vertices, GL_STATIC_DRAW);
+        vbo.setColorData(holder.colors.data(), vertices, GL_STATIC_DRAW);
+        stroke.uploaded = true;
+    }
+    vbo.setAttributeData(instanceAxesLocation, instanceAxes.data(), 4, instanceCount, GL_STREAM_DRAW);
+    vbo.setAttributeData(instanceOffsetLocation, instanceOffsets.data(), 2, instanceCount, GL_STREAM_DRAW);
+    vbo.setAttributeData(instanceTintLocation, instanceTints.data(), 4, instanceCount, GL_STREAM_DRAW);
+    vbo.setAttributeDivisor(instanceAxesLocation, 1);
+    vbo.setAttributeDivisor(instanceOffsetLocation, 1);
+    vbo.setAttributeDivisor(instanceTintLocation, 1);
+    
+    instanceShader.begin();
+    vbo.drawInstanced(glPrimitive(holder.glmode), 0, vertices, instanceCount);
+    instanceShader.end();
+}
+
+void Renderer::drawInstanced(InstancedStroke& stroke, const std::vector<Instance>& instances) {
+    drawInstanced(stroke, instances.data(), instances.size());
+}
+
+void Renderer::drawInstanced(const VertexArrayHolder& holder, const Instance* instances, size_t count) {
+    lastStroke.set(holder);
+    drawInstanced(lastStroke, instances, count);
+}
+
+void Renderer::drawInstanced(const Polyline& polyline, const std::vector<Instance>& instances) {
+    drawInstanced(polyline.holder, instances.data(), instances.size());
+}
+
+void InstancedStroke::set(const VertexArrayHolder& source) {
+    if (source.glmode == holder.glmode &&
+        std::equal(source.vertices.begin(), source.vertices.end(),
+                   holder.vertices.begin(), holder.vertices.end()) &&
+        std::equal(source.colors.begin(), source.colors.end(),
+                   holder.colors.begin(), holder.colors.end())) {
+        return;
+    }
+    holder.setGlDrawMode(source.glmode);
+    holder.vertices.assign(source.vertices.begin(), source.vertices.end());
+    holder.colors.assign(source.colors.begin(), source.colors.end());
+    uploaded = false;
+}
+
+void Renderer::transformInstances(const VertexArrayHolder& holder,
+                                  const Instance* instances, size_t count,
+                                  VertexArrayHolder& out) {
+    out.clear();
+    if (holder.glmode == VertexArrayHolder::DRAW_TRIANGLE_STRIP) {
+        // Strips can't simply follow one another
+        VertexArrayHolder triangles;
+        triangles.push(holder);
+        transformInstances(triangles, instances, count, out);
+        return;
+    }
+    out.setGlDrawMode(holder.glmode);
+    
+    size_t n = holder.vertices.size();
+    out.vertices.resize(n * count);
+    out.colors.resize(n * count);
+    glm::vec3* v = out.vertices.data();
+    ofFloatColor* c = out.colors.data();
+    for (size_t i = 0; i < count; i++) {
+        const Instance& in = instances[i];
+        for (size_t j = 0; j < n; j++, v++, c++) {
+            const glm::vec3& p = holder.vertices[j];
+            *v = glm::vec3(in.apply(glm::vec2(p)), p.z);
+            const ofFloatColor& col = holder.colors[j];
+            *c = ofFloatColor(col.r * in.tint.r, col.g * in.tint.g,
+                              col.b * in.tint.b, col.a * in.tint.a);
+        }
+    }
+}
+
+// ============================================================================
+// Tessellation Cache
+// ============================================================================
+
+namespace {
+
+// Word-at-a-time 64-bit mix. Not cryptographic: it only has to tell inputs apart.
+struct InputHash {
+    uint64_t h = 0x9E3779B97F4A7C15ull;
+    
+    void mix(uint64_t w) {
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 29;
+    }
+    void add(float f) {
+        uint32_t w;
+        memcpy(&w, &f, sizeof(w));
+        mix(w);
+    }
+    void add(const glm::vec2& v) {
+        uint64_t w;
+        memcpy(&w, &v, sizeof(w));
+        mix(w);
+    }
+    void add(const ofFloatColor& c) {
+        add(c.r); add(c.g); add(c.b); add(c.a);
+    }
+    
+    // Every field that changes the tessellation; the memory resource doesn't
+    void add(const Options& opt) {
+        mix(static_cast<uint64_t>(opt.joint) | static_cast<uint64_t>(opt.cap) << 8 |
+            static_cast<uint64_t>(opt.capPosition) << 16 |
+            static_cast<uint64_t>(opt.feather) << 24 | static_cast<uint64_t>(opt.noFeatherAtCap) << 25 |
+            static_cast<uint64_t>(opt.noFeatherAtCore) << 26 | static_cast<uint64_t>(opt.clip) << 27 |
+            static_cast<uint64_t>(static_cast<uint32_t>(opt.smoothing)) << 32);
+        add(opt.feathering);
+        add(opt.worldToScreenRatio);
+        add(opt.getSmoothingTolerance());
+        add(opt.miterLimit);
+        add(opt.approxAngle);
+        add(opt.approxAngleThin);
+        add(opt.approxAngleShort);
+        add(opt.approxThinWidth);
+        add(opt.arcStep);
+        add(opt.hairlineWidth);
+        mix(opt.hairlineLines | opt.pixelSnap << 1);
+        if (opt.clip) {
+            add(opt.clipRect.x); add(opt.clipRect.y);
+            add(opt.clipRect.width); add(opt.clipRect.height);
+        }
+    }
+    
+    void add(const PointView& points) {
+        mix(points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            add(points[i]);
+        }
+    }
+};
+
+} // namespace
+
+TessellationCache::TessellationCache(size_t budgetBytes)
+    : budget(budgetBytes) {}
+
+void TessellationCache::setBudget(size_t bytes) {
+    budget = bytes;
+    while (this->bytes > budget) {
+        erase(std::prev(entries.end()));
+    }
+}
+
+void TessellationCache::setGpuResident(bool enabled) {
+    if (enabled == gpuResident) return;
+    clear();
+    gpuResident = enabled;
+}
+
+void TessellationCache::clear() {
+    entries.clear();
+    index.clear();
+    bytes = 0;
+}
+
+void TessellationCache::erase(std::list<Entry>::iterator it) {
+    bytes -= it->bytes;
+    index.erase(it->hash);
+    entries.erase(it);
+}
+
+template <class Tessellate>
+bool TessellationCache::draw(Renderer& renderer, uint64_t hash, size_t count,
+                             Tessellate tessellate) {
+    auto found = index.find(hash);
+    if (found != index.end() && found->second->count == count) {
+        hits++;
+        entries.splice(entries.begin(), entries, found->second);
+        const Entry& e = entries.front();
+        if (gpuResident) {
+            if (capture::enabled()) capture::draw(e.holder.glmode, e.vboCount);
+            e.vbo.draw(glPrimitive(e.holder.glmode), 0, e.vboCount);
+        } else {
+            renderer.draw(e.holder);
+        }
+        return true;
+    }
+    misses++;
+    if (found != index.end()) {
+        erase(found->second);
+    }
+    
+    tessellate();
+    renderer.draw(line);
+    
+    const VertexArrayHolder& out = line.holder;
+    size_t entryBytes = sizeof(Entry) + out.vertices.size() * (sizeof(glm::vec3) + sizeof(ofFloatColor));
+    if (entryBytes > budget) return false;
+    while (bytes + entryBytes > budget) {
+        erase(std::prev(entries.end()));
+    }
+    
+    // Stored at its exact size; line keeps its larger buffers for the next miss
+    entries.emplace_front();
+    Entry& e = entries.front();
+    e.hash = hash;
+    e.count = count;
+    e.bytes = entryBytes;
+    e.holder.setGlDrawMode(out.glmode);
+    if (gpuResident) {
+        e.vboCount = out.getCount();
+        e.vbo.setVertexData(out.vertices.data(), e.vboCount, GL_STATIC_DRAW);
+        e.vbo.setColorData(out.colors.data(), e.vboCount, GL_STATIC_DRAW);
+    } else {
+        e.holder.vertices.assign(out.vertices.begin(), out.vertices.end());
+        e.holder.colors.assign(out.colors.begin(), out.colors.end());
+    }
+    index[hash] = entries.begin();
+    bytes += entryBytes;
+    return false;
+}
+
+bool TessellationCache::draw(Renderer& renderer, const PointView& points,
+                             const ofFloatColor& color, float width, const Options& opt) {
+    if (budget == 0) {
+        line.rebuild(points, color, width, opt);
+        renderer.draw(line);
+        return false;
+    }
+    InputHash key;
+    key.add(points);
+    key.add(color);
+    key.add(width);
+    key.add(opt);
+    return draw(renderer, key.h, points.size(), [&] { line.rebuild(points, color, width, opt); });
+}
+
+bool TessellationCache::draw(Renderer& renderer, const PointView& points,
+                             const ColorView& colors, const WidthView& widths,
+                             const Options& opt) {
+    if (budget == 0) {
+        line.rebuild(points, colors, widths, opt);
+        renderer.draw(line);
+        return false;
+    }
+    // Per-vertex input hashes differently from the constant overload even when
+    // the arrays have one entry, since the two take different paths
+    InputHash key;
+    key.mix(~uint64_t(0));
+    key.add(points);
+    key.mix(colors.size());
+    for (size_t i = 0; i < colors.size(); i++) {
+        key.add(colors[i]);
+    }
+    key.mix(widths.size());
+    for (size_t i = 0; i < widths.size(); i++) {
+        key.add(widths[i]);
+    }
+    key.add(opt);
+    return draw(renderer, key.h, points.size(), [&] { line.rebuild(points, colors, widths, opt); });
+}
+
+
+// ============================================================================
+// Quality Controller
+// ============================================================================
+
+Options QualityController::apply(Options opt) const {
+    return opt.setQuality(quality);
+}
+
+void QualityController::setRange(Quality lowest, Quality highest) {
+    this->lowest = std::min(lowest, highest);
+    this->highest = std::max(lowest, highest);
+    quality = std::min(std::max(quality, this->lowest), this->highest);
+}
+
+void QualityController::setRestore(int frames, float fraction) {
+    restoreFrames = std::max(1, frames);
+    restoreFraction = fraction;
+}
+
+void QualityController::beginFrame() {
+    frameStart = std::chrono::steady_clock::now();
+}
+
+void QualityController::endFrame(size_t vertices) {
+    endFrame(vertices, std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count());
+}
+
+void QualityController::endFrame(size_t vertices, double seconds) {
+    // Fraction of the tighter budget this frame used
+    double load = 0;
+    if (vertexBudget > 0) load = std::max(load, static_cast<double>(vertices) / vertexBudget);
+    if (timeBudget > 0) load = std::max(load, seconds / timeBudget);
+    
+    if (load > 1.0) {
+        // Over: step down at once, so a spike costs one frame
+        if (quality > lowest) quality = static_cast<Quality>(static_cast<int>(quality) - 1);
+        calmFrames = 0;
+    } else if (load < restoreFraction && quality < highest) {
+        // Well under for long enough: step back up
+        if (++calmFrames >= restoreFrames) {
+            quality = static_cast<Quality>(static_cast<int>(quality) + 1);
+            calmFrames = 0;
+        }
+    } else {
+        calmFrames = 0;
+    }
+}
+
 // ============================================================================
 // Simple OF-Style API Implementation
 // ============================================================================
@@ -1816,6 +3389,8 @@ void Renderer::draw(const Segment& segment) {
 namespace {
     Options g_options;
     Renderer g_renderer;
+    TessellationCache g_cache;
+    MarkerBatch g_markers;  // reused by drawPoints
     bool g_rendererInitialized = false;
     
     Renderer& getRenderer() {
@@ -1825,6 +3400,15 @@ namespace {
         }
         return g_renderer;
     }
+    
+    // A short width list is padded with its last entry, as a short color list is
+    WidthView paddedWidths(const std::vector<float>& widths, size_t count,
+                           std::vector<float>& padded) {
+        if (widths.size() >= count || widths.size() == 1) return widths;
+        padded.assign(count, widths.back());
+        std::copy(widths.begin(), widths.end(), padded.begin());
+        return padded;
+    }
 }
 
 void draw(const ofPolyline& polyline, float width) {
@@ -1835,58 +3419,65 @@ void draw(const ofPolyline& polyline, float width) {
 void draw(const ofPolyline& polyline, const ofColor& color, float width) {
     if (polyline.size() < 2) return;
     
-    Polyline poly(polyline, ofFloatColor(color), width, g_options);
+    ofFloatColor floatColor(color);
+    capture::Pause pause;  // logged whole below, with whether the cache had it
     
     auto& renderer = getRenderer();
     renderer.begin();
-    renderer.draw(poly);
+    bool cached = g_cache.draw(renderer, pointsOf(polyline), floatColor, width, g_options);
     renderer.end();
+    
+    if (capture::enabled()) capture::polyline(pointsOf(polyline), floatColor, width, g_options, cached);
 }
 
 void draw(const ofPolyline& polyline, const ofColor& color, 
           const std::vector<float>& widths) {
-    if (polyline.size() < 2) return;
-    
-    std::vector<glm::vec2> points;
-    for (size_t i = 0; i < polyline.size(); i++) {
-        points.push_back(glm::vec2(polyline[i].x, polyline[i].y));
-    }
+    if (polyline.size() < 2 || widths.empty()) return;
     
-    std::vector<ofFloatColor> colors(points.size(), ofFloatColor(color));
+    ofFloatColor floatColor(color);
+    std::vector<float> padded;
+    WidthView widthView = paddedWidths(widths, polyline.size(), padded);
     
-    Polyline poly(points, colors, widths, g_options);
+    capture::Pause pause;
     
     auto& renderer = getRenderer();
     renderer.begin();
-    renderer.draw(poly);
+    bool cached = g_cache.draw(renderer, pointsOf(polyline), ColorView(&floatColor, 1), widthView,
+                               g_options);
     renderer.end();
+    
+    if (capture::enabled()) {
+        capture::polyline(pointsOf(polyline), ColorView(&floatColor, 1), widthView, g_options, cached);
+    }
 }
 
 void draw(const ofPolyline& polyline, 
           const std::vector<ofColor>& colors,
           const std::vector<float>& widths) {
-    if (polyline.size() < 2) return;
+    if (polyline.size() < 2 || widths.empty()) return;
     
-    std::vector<glm::vec2> points;
+    // Read the 8-bit colors in place; only a short list is padded with its last entry
+    ColorView colorView(colors);
     std::vector<ofFloatColor> floatColors;
-    
-    for (size_t i = 0; i < polyline.size(); i++) {
-        points.push_back(glm::vec2(polyline[i].x, polyline[i].y));
-        if (i < colors.size()) {
-            floatColors.push_back(ofFloatColor(colors[i]));
-        } else if (!colors.empty()) {
-            floatColors.push_back(ofFloatColor(colors.back()));
-        } else {
-            floatColors.push_back(ofFloatColor(1, 1, 1, 1));
+    if (colors.size() < polyline.size() && colors.size() != 1) {
+        floatColors.assign(polyline.size(), colors.empty() ? ofFloatColor(1, 1, 1, 1)
+                                                           : ofFloatColor(colors.back()));
+        for (size_t i = 0; i < colors.size(); i++) {
+            floatColors[i] = ofFloatColor(colors[i]);
         }
+        colorView = floatColors;
     }
+    std::vector<float> padded;
+    WidthView widthView = paddedWidths(widths, polyline.size(), padded);
     
-    Polyline poly(points, floatColors, widths, g_options);
+    capture::Pause pause;
     
     auto& renderer = getRenderer();
     renderer.begin();
-    renderer.draw(poly);
+    bool cached = g_cache.draw(renderer, pointsOf(polyline), colorView, widthView, g_options);
     renderer.end();
+    
+    if (capture::enabled()) capture::polyline(pointsOf(polyline), colorView, widthView, g_options, cached);
 }
 
 void drawLine(float x1, float y1, float x2, float y2, float width) {
@@ -1900,7 +3491,13 @@ void drawLine(const glm::vec2& p1, const glm::vec2& p2, float width) {
 
 void drawLine(const glm::vec2& p1, const glm::vec2& p2, 
               const ofColor& color, float width) {
-    Segment seg(p1, p2, ofFloatColor(color), width, g_options);
+    ofFloatColor floatColor(color);
+    if (capture::enabled()) {
+        const glm::vec2 points[] = { p1, p2 };
+        capture::polyline(PointView(points, 2), floatColor, width, g_options);
+    }
+    capture::Pause pause;
+    Segment seg(p1, p2, floatColor, width, g_options);
     
     auto& renderer = getRenderer();
     renderer.begin();
@@ -1920,7 +3517,14 @@ void drawLine(const glm::vec2& p1, const glm::vec2& p2,
 void drawLine(const glm::vec2& p1, const glm::vec2& p2,
               const ofColor& c1, const ofColor& c2,
               float width1, float width2) {
-    Segment seg(p1, p2, ofFloatColor(c1), ofFloatColor(c2), width1, width2, g_options);
+    const ofFloatColor colors[] = { ofFloatColor(c1), ofFloatColor(c2) };
+    if (capture::enabled()) {
+        const glm::vec2 points[] = { p1, p2 };
+        const float widths[] = { width1, width2 };
+        capture::polyline(PointView(points, 2), ColorView(colors, 2), WidthView(widths, 2), g_options);
+    }
+    capture::Pause pause;
+    Segment seg(p1, p2, colors[0], colors[1], width1, width2, g_options);
     
     auto& renderer = getRenderer();
     renderer.begin();
@@ -1928,6 +3532,61 @@ void drawLine(const glm::vec2& p1, const glm::vec2& p2,
     renderer.end();
 }
 
+void drawPoints(const std::vector<glm::vec2>& centers, float radius) {
+    ofFloatColor color = ofGetStyle().color;
+    drawPoints(centers, ofColor(color.r * 255, color.g * 255, color.b * 255, color.a * 255), radius);
+}
+
+void drawPoints(const std::vector<glm::vec2>& centers, const ofColor& color, float radius) {
+    ofFloatColor floatColor(color);
+    g_markers.clear();
+    g_markers.add(centers, WidthView(&radius, 1), ColorView(&floatColor, 1), g_options);
+    
+    auto& renderer = getRenderer();
+    renderer.begin();
+    renderer.draw(g_markers);
+    renderer.end();
+}
+
+void drawPoints(const std::vector<glm::vec2>& centers,
+                const std::vector<ofColor>& colors,
+                const std::vector<float>& radii) {
+    // Read the 8-bit colors in place; add() stops at the shortest list
+    g_markers.clear();
+    g_markers.add(centers, radii, colors, g_options);
+    
+    auto& renderer = getRenderer();
+    renderer.begin();
+    renderer.draw(g_markers);
+    renderer.end();
+}
+
+void drawRect(const ofRectangle& rect, float width) {
+    ofFloatColor color = ofGetStyle().color;
+    drawRect(rect, ofColor(color.r * 255, color.g * 255, color.b * 255, color.a * 255), width);
+}
+
+void drawRect(const ofRectangle& rect, const ofColor& color, float width) {
+    const glm::vec2 points[] = {
+        { rect.getLeft(), rect.getTop() }, { rect.getRight(), rect.getTop() },
+        { rect.getRight(), rect.getBottom() }, { rect.getLeft(), rect.getBottom() },
+        { rect.getLeft(), rect.getTop() }
+    };
+    // Smoothing would round the corners and keep the stroke off the fast path
+    Options opt = g_options;
+    opt.pixelSnap = true;
+    opt.smoothing = 0;
+    opt.smoothingTolerance = 0;
+    if (capture::enabled()) capture::polyline(PointView(points, 5), ofFloatColor(color), width, opt);
+    capture::Pause pause;
+    Polyline outline(PointView(points, 5), ofFloatColor(color), width, opt);
+    
+    auto& renderer = getRenderer();
+    renderer.begin();
+    renderer.draw(outline);
+    renderer.end();
+}
+
 void setJointStyle(JointStyle style) {
     g_options.joint = style;
 }
@@ -1941,8 +3600,20 @@ void setFeather(bool enabled, float amount) {
     g_options.feathering = amount;
 }
 
+void setQuality(Quality q) {
+    g_options.setQuality(q);
+}
+
 Options& getOptions() {
     return g_options;
 }
 
+void setCacheBudget(size_t bytes) {
+    g_cache.setBudget(bytes);
+}
+
+TessellationCache& getCache() {
+    return g_cache;
+}
+
 } // namespace ofxVase
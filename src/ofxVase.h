@@ -17,6 +17,12 @@
  */
 
 #include "ofMain.h"
+#include <memory_resource>
+#include <list>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <unordered_map>
 
 namespace ofxVase {
 
@@ -44,6 +50,13 @@ enum class CapPosition : char {
     None  = 30
 };
 
+// Presets for the tessellation quality knobs in Options (see Options::setQuality)
+enum class Quality : char {
+    Draft  = 0,  // fewer arc vertices, approximate strips at sharper turns, coarser smoothing
+    Normal = 1,  // the defaults
+    High   = 2   // more arc vertices, exact joints at all but very gentle turns
+};
+
 struct Options {
     JointStyle joint = JointStyle::Round;
     CapStyle cap = CapStyle::Round;
@@ -54,8 +67,46 @@ struct Options {
     bool noFeatherAtCore = false;
     float worldToScreenRatio = 1.0f;
     int smoothing = 0;
+    float smoothingTolerance = 0.0f;  // > 0: adaptive, smoothing is the max per segment
     float miterLimit = 4.0f;
     
+    // Quality knobs, set together by setQuality(). Constant-color, constant-width
+    // strokes switch to cheaper approximate strips where consecutive segments
+    // turn by less than approxAngle degrees; by less than approxAngleThin for
+    // strokes under approxThinWidth screen pixels wide, and by less than
+    // approxAngleShort where the segments are shorter than the width.
+    float approxAngle = 10.0f;
+    float approxAngleThin = 15.0f;
+    float approxAngleShort = 25.0f;
+    float approxThinWidth = 7.0f;
+    float arcStep = 1.0f;               // scales the angle between round joint and cap vertices
+    // With smoothing on, the tolerance is raised to at least smoothingToleranceMin,
+    // which makes fixed smoothing adaptive, and adaptive smoothing is held to at
+    // most smoothingToleranceMax pixels off the curve (0: no limit)
+    float smoothingToleranceMin = 0.0f;
+    float smoothingToleranceMax = 0.0f;
+    
+    // Hairlines: strokes no wider than hairlineWidth screen pixels (0: off) get
+    // one anti-aliased quad pair per segment and small joint and cap patches
+    // instead of the full joint machinery. With hairlineLines they become
+    // aliased GL_LINES, two vertices per segment (triangles when streamed).
+    float hairlineWidth = 0.0f;
+    bool hairlineLines = false;
+    
+    // Pixel snapping: constant-width strokes whose segments are all horizontal
+    // or vertical (grids, axes, ticks, rectangle outlines) become one quad per
+    // segment on whole pixels, without fades or round caps. Widths round to
+    // whole pixels; thinner strokes cover one pixel at partial alpha.
+    bool pixelSnap = false;
+    
+    // Viewport clipping: segments whose stroke cannot reach clipRect are skipped
+    bool clip = false;
+    ofRectangle clipRect;
+    
+    // Where the output and scratch buffers are allocated (nullptr: default resource),
+    // e.g. a per-frame std::pmr::monotonic_buffer_resource
+    std::pmr::memory_resource* memoryResource = nullptr;
+    
     Options() = default;
     
     Options& setJoint(JointStyle j) { joint = j; return *this; }
@@ -68,7 +119,114 @@ struct Options {
     }
     Options& setScale(float s) { worldToScreenRatio = s; return *this; }
     Options& setSmoothing(int subdivisions) { smoothing = subdivisions; return *this; }
+    Options& setAdaptiveSmoothing(float tolerance, int maxSubdivisions = 16) {
+        smoothingTolerance = tolerance;
+        smoothing = maxSubdivisions;
+        return *this;
+    }
     Options& setMiterLimit(float limit) { miterLimit = limit; return *this; }
+    Options& setPixelSnap(bool snap) { pixelSnap = snap; return *this; }
+    Options& setHairline(float maxWidth, bool lines = false) {
+        hairlineWidth = maxWidth;
+        hairlineLines = lines;
+        return *this;
+    }
+    // Sets the quality knobs above; the other options are left as they are
+    Options& setQuality(Quality q);
+    // The smoothing tolerance the tessellator uses (0: fixed subdivisions)
+    float getSmoothingTolerance() const {
+        float tolerance = std::max(smoothingTolerance, smoothingToleranceMin);
+        if (tolerance > 0 && smoothingToleranceMax > 0) tolerance = std::min(tolerance, smoothingToleranceMax);
+        return tolerance;
+    }
+    Options& setClipRect(const ofRectangle& r) { clipRect = r; clip = true; return *this; }
+    Options& clearClipRect() { clip = false; return *this; }
+    Options& setMemoryResource(std::pmr::memory_resource* mr) { memoryResource = mr; return *this; }
+    
+    std::pmr::memory_resource* getMemoryResource() const {
+        return memoryResource ? memoryResource : std::pmr::get_default_resource();
+    }
+};
+
+// ============================================================================
+// Input Views - Read polyline data where it already is
+// ============================================================================
+
+// Read-only view of count values spaced stride bytes apart: a std::vector, the
+// x/y of ofPolyline's glm::vec3 vertices, or one member of an array of structs.
+// A stride of 0 repeats the first value.
+template <class T>
+class StridedView {
+public:
+    StridedView() = default;
+    StridedView(const std::vector<T>& v) : StridedView(v.data(), v.size()) {}
+    StridedView(const T* first, size_t count, size_t stride = sizeof(T))
+        : StridedView(static_cast<const void*>(first), count, stride) {}
+    StridedView(const void* first, size_t count, size_t stride)
+        : data(static_cast<const unsigned char*>(first)), count(count), stride(stride) {}
+    
+    T operator[](size_t i) const {
+        T v;
+        memcpy(&v, data + i * stride, sizeof(T));
+        return v;
+    }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    
+private:
+    const unsigned char* data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+};
+
+using PointView = StridedView<glm::vec2>;
+using WidthView = StridedView<float>;
+
+// Strided view of ofFloatColor or 8-bit ofColor values, read as ofFloatColor
+class ColorView {
+public:
+    ColorView() = default;
+    ColorView(const std::vector<ofFloatColor>& v) : ColorView(v.data(), v.size()) {}
+    ColorView(const std::vector<ofColor>& v) : ColorView(v.data(), v.size()) {}
+    ColorView(const ofFloatColor* first, size_t count, size_t stride = sizeof(ofFloatColor))
+        : data(reinterpret_cast<const unsigned char*>(first)), count(count), stride(stride) {}
+    ColorView(const ofColor* first, size_t count, size_t stride = sizeof(ofColor))
+        : data(reinterpret_cast<const unsigned char*>(first)), count(count), stride(stride),
+          eightBit(true) {}
+    
+    ofFloatColor operator[](size_t i) const {
+        const unsigned char* p = data + i * stride;
+        if (eightBit) {
+            ofColor c;
+            memcpy(&c, p, sizeof(ofColor));
+            return ofFloatColor(c);
+        }
+        ofFloatColor c;
+        memcpy(&c, p, sizeof(ofFloatColor));
+        return c;
+    }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    
+private:
+    const unsigned char* data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    bool eightBit = false;
+};
+
+// The x/y of an ofPolyline's vertices, without copying them
+inline PointView pointsOf(const ofPolyline& poly) {
+    return poly.size() ? PointView(static_cast<const void*>(&poly.getVertices()[0]),
+                                   poly.size(), sizeof(glm::vec3))
+                       : PointView();
+}
+
+// What a generator passed to Polyline returns for each index
+struct VertexInput {
+    glm::vec2 pos;
+    ofFloatColor color;
+    float width;
 };
 
 // ============================================================================
@@ -79,13 +237,19 @@ class VertexArrayHolder {
 public:
     static constexpr int DRAW_TRIANGLES = 0;
     static constexpr int DRAW_TRIANGLE_STRIP = 1;
+    static constexpr int DRAW_LINES = 2;
     
     int glmode = DRAW_TRIANGLES;
     
-    std::vector<glm::vec3> vertices;
-    std::vector<ofFloatColor> colors;
+    std::pmr::vector<glm::vec3> vertices;
+    std::pmr::vector<ofFloatColor> colors;
+    
+    VertexArrayHolder() = default;
+    // Allocates from mr; copies of the holder use the default resource again
+    explicit VertexArrayHolder(std::pmr::memory_resource* mr);
     
     void clear();
+    void reserve(size_t n) { vertices.reserve(n); colors.reserve(n); }
     int getCount() const { return static_cast<int>(vertices.size()); }
     void setGlDrawMode(int mode) { glmode = mode; }
     
@@ -100,7 +264,8 @@ public:
     void push4(const glm::vec2& p1, const glm::vec2& p2, const glm::vec2& p3, const glm::vec2& p4,
                const ofFloatColor& c1, const ofFloatColor& c2, const ofFloatColor& c3, const ofFloatColor& c4);
     
-    // Merge another holder
+    // Merge another holder; strips and lines merge into triangles, lines as
+    // quads one unit wide
     void push(const VertexArrayHolder& other);
     
     glm::vec2 get(int i) const;
@@ -115,6 +280,77 @@ private:
     void repeatLastPush();
 };
 
+// ============================================================================
+// Vertex Sinks - Where streamed tessellation output goes
+// ============================================================================
+
+// Receives triangle-list vertices in batches from Polyline::tessellateInto
+class VertexSink {
+public:
+    virtual ~VertexSink() = default;
+    virtual void write(const glm::vec3* positions, const ofFloatColor* colors, size_t count) = 0;
+    // Before a polyline's batches: at most n vertices will follow
+    virtual void reserve(size_t n) {}
+};
+
+enum class ColorFormat : char {
+    None   = 0,
+    Float4 = 1,  // 4 floats, 0..1
+    UByte4 = 2   // RGBA8, as GL_UNSIGNED_BYTE normalized
+};
+
+// Byte layout of one vertex in an interleaved buffer
+struct VertexLayout {
+    int stride = 24;              // bytes from one vertex to the next
+    int positionOffset = 0;
+    int positionComponents = 2;   // 2: xy, 3: xyz
+    int colorOffset = 8;
+    ColorFormat colorFormat = ColorFormat::Float4;
+};
+
+// Writes into caller memory: a span, or a pointer from glMapBufferRange.
+// Vertices past capacity are dropped and counted, so size the buffer with
+// Polyline::estimateVertexCount.
+class InterleavedSink : public VertexSink {
+public:
+    InterleavedSink(void* data, size_t capacity, const VertexLayout& layout = VertexLayout());
+    
+    void write(const glm::vec3* positions, const ofFloatColor* colors, size_t count) override;
+    
+    size_t getCount() const { return count; }
+    size_t getDropped() const { return dropped; }
+    void reset() { count = 0; dropped = 0; }
+    
+private:
+    unsigned char* data;
+    size_t capacity;
+    VertexLayout layout;
+    size_t count = 0;
+    size_t dropped = 0;
+};
+
+// Appends to an existing triangle holder, to accumulate many polylines in one
+class HolderSink : public VertexSink {
+public:
+    explicit HolderSink(VertexArrayHolder& target) : target(target) {}
+    void write(const glm::vec3* positions, const ofFloatColor* colors, size_t count) override;
+    void reserve(size_t n) override { target.reserve(target.vertices.size() + n); }
+    
+private:
+    VertexArrayHolder& target;
+};
+
+// Only counts, for dry runs
+class CountingSink : public VertexSink {
+public:
+    void write(const glm::vec3*, const ofFloatColor*, size_t n) override { count += n; }
+    size_t getCount() const { return count; }
+    void reset() { count = 0; }
+    
+private:
+    size_t count = 0;
+};
+
 // ============================================================================
 // Polyline - Main tessellation class
 // ============================================================================
@@ -125,14 +361,17 @@ public:
     
     Polyline() = default;
     
-    Polyline(const std::vector<glm::vec2>& points, 
+    // Empty polyline whose buffers live on mr, to be filled by rebuild()
+    explicit Polyline(std::pmr::memory_resource* mr);
+    
+    Polyline(const PointView& points, 
              const ofFloatColor& color, 
              float width,
              const Options& opt = Options());
     
-    Polyline(const std::vector<glm::vec2>& points,
-             const std::vector<ofFloatColor>& colors,
-             const std::vector<float>& widths,
+    Polyline(const PointView& points,
+             const ColorView& colors,
+             const WidthView& widths,
              const Options& opt = Options());
     
     Polyline(const ofPolyline& poly,
@@ -140,10 +379,60 @@ public:
              float width,
              const Options& opt = Options());
     
+    // count vertices from f(i) -> VertexInput, for input that isn't stored
+    // anywhere. Tessellated as f runs, like PolylineStream, except with clipping,
+    // hairlines or pixel snapping, which look at the whole stroke first.
+    template <class Generator>
+    Polyline(size_t count, Generator f, const Options& opt = Options())
+        : holder(opt.memoryResource), scratch(opt.memoryResource) {
+        rebuild(count, f, opt);
+    }
+    
+    // Clear and retessellate into the existing holder and scratch buffers, so
+    // per-frame animation stops allocating once the capacity has grown.
+    // Buffers stay on the resource this polyline was constructed with.
+    void rebuild(const PointView& points,
+                 const ofFloatColor& color,
+                 float width,
+                 const Options& opt = Options());
+    
+    void rebuild(const PointView& points,
+                 const ColorView& colors,
+                 const WidthView& widths,
+                 const Options& opt = Options());
+    
+    template <class Generator>
+    void rebuild(size_t count, Generator f, const Options& opt = Options());
+    
+    // Stream the triangles into sink instead of keeping them: the holder only
+    // stages a few thousand vertices at a time and is left empty.
+    void tessellateInto(VertexSink& sink,
+                        const PointView& points,
+                        const ofFloatColor& color,
+                        float width,
+                        const Options& opt = Options());
+    
+    void tessellateInto(VertexSink& sink,
+                        const PointView& points,
+                        const ColorView& colors,
+                        const WidthView& widths,
+                        const Options& opt = Options());
+    
     ofMesh getMesh() const { return holder.toMesh(); }
     void append(const Polyline& other) { holder.push(other.holder); }
     
+    // Upper bound on holder.getCount() for the matching constructor, one cheap pass
+    // over the points, e.g. to size a vertex buffer ahead of tessellation.
+    static size_t estimateVertexCount(const PointView& points, float width,
+                                      const Options& opt = Options());
+    static size_t estimateVertexCount(const PointView& points,
+                                      const WidthView& widths,
+                                      const Options& opt = Options());
+    
 private:
+    friend class PolylineStream;
+    friend class MarkerBatch;
+    
     struct InternalOpt {
         bool constColor = false;
         bool constWeight = false;
@@ -151,8 +440,35 @@ private:
         bool noCapLast = false;
         bool joinFirst = false;
         bool joinLast = false;
+        int first = 0;       // bounds of the run being tessellated
+        int last = 0;
         std::vector<float> segmentLength;
-        VertexArrayHolder holder;
+    };
+    
+    // Per-vertex input of the exact tessellator, as structure-of-arrays so
+    // radii, tangents and miters run through the batch kernels
+    struct VertexStream {
+        std::pmr::vector<float> x, y, w, t, r;
+        std::pmr::vector<ofFloatColor> col;
+        
+        explicit VertexStream(std::pmr::memory_resource* mr)
+            : x(mr), y(mr), w(mr), t(mr), r(mr), col(mr) {}
+        
+        int size() const { return static_cast<int>(x.size()); }
+        glm::vec2 pos(int i) const { return glm::vec2(x[i], y[i]); }
+        void resize(int n) {
+            x.resize(n); y.resize(n); w.resize(n);
+            t.resize(n); r.resize(n); col.resize(n);
+        }
+        // Drop all but the last count vertices
+        void keepLast(int count) {
+            int from = size() - count;
+            for (int i = 0; i < count; i++) {
+                x[i] = x[from + i]; y[i] = y[from + i]; w[i] = w[from + i];
+                t[i] = t[from + i]; r[i] = r[from + i]; col[i] = col[from + i];
+            }
+            resize(count);
+        }
     };
     
     struct StPolyline {
@@ -180,47 +496,132 @@ private:
         float W[3];
         StPolyline SL[3];
         VertexArrayHolder vah;
+        VertexArrayHolder strip;  // cap strip, expanded into vah
         glm::vec2 capStart{0}, capEnd{0};
+        
+        explicit StAnchor(std::pmr::memory_resource* mr) : vah(mr), strip(mr) {}
+    };
+    
+    // Per-build buffers kept between rebuild() calls. Copies start empty.
+    struct Scratch {
+        VertexStream vertices;  // exact path input and spline samples
+        std::pmr::vector<float> ntx, nty, nbx, nby;
+        std::pmr::vector<float> coreX, coreY, fadeX, fadeY;
+        std::pmr::vector<int32_t> degenerate, miterValid, topInner;
+        VertexArrayHolder core, fadeOut, fadeIn;  // approx strips
+        StAnchor anchor;
+        // Generator input, gathered for the options that can't stream it
+        std::pmr::vector<glm::vec2> points;
+        std::pmr::vector<ofFloatColor> colors;
+        std::pmr::vector<float> widths;
+        
+        explicit Scratch(std::pmr::memory_resource* mr = nullptr);
+        Scratch(const Scratch&) : Scratch(nullptr) {}
+        Scratch& operator=(const Scratch&) { return *this; }
     };
     
+    Scratch scratch;
+    VertexSink* sink = nullptr;  // set during tessellateInto
+    
+    // Hands the staged triangles to the sink once there are enough of them
+    void flush(bool force);
+    // Sizes the holder, or tells the sink, for at most n output vertices
+    void reserveOutput(size_t n);
+    
     static void determineTr(float w, float& t, float& R, float scale);
-    static float getPljRoundDangle(float t, float r, float scale);
+    static float getPljRoundDangle(float t, float r, const Options& opt);
+    
+    static float clipMargin(const WidthView& W, const Options& opt);
+    static void strokeVertexBounds(float maxWidth, const Options& opt, size_t& disc, size_t& cap);
+    static size_t exactVertexBound(const PointView& points,
+                                   const WidthView& widths, const Options& opt);
     
     static void makeTrc(const glm::vec2& P1, const glm::vec2& P2,
                         glm::vec2& T, glm::vec2& R, glm::vec2& C,
                         float w, const Options& opt,
                         float& rr, float& tt, float& dist);
     
-    void polylineRange(const std::vector<glm::vec2>& P,
-                       const std::vector<ofFloatColor>& C,
-                       const std::vector<float>& W,
+    void tessellate(const PointView& P,
+                    const ColorView& C,
+                    const WidthView& W,
+                    const Options& opt, const InternalOpt& inopt,
+                    bool classify);
+    
+    void tessellateSmooth(const PointView& P,
+                          const ColorView& C,
+                          const WidthView& W,
+                          const Options& opt, const InternalOpt& inopt);
+    
+    static void smoothVertices(const PointView& P,
+                               const ColorView& C,
+                               const WidthView& W,
+                               const Options& opt, const InternalOpt& inopt,
+                               VertexStream& V);
+    
+    void tessellateRun(const PointView& P,
+                       const ColorView& C,
+                       const WidthView& W,
+                       const Options& opt, InternalOpt& inopt,
+                       bool classify);
+    
+    void polylineRange(const PointView& P,
+                       const ColorView& C,
+                       const WidthView& W,
                        const Options& opt, InternalOpt& inopt,
                        int from, int to, bool approx);
     
-    void polylineApprox(const std::vector<glm::vec2>& P,
-                        const std::vector<ofFloatColor>& C,
-                        const std::vector<float>& W,
+    void polylineApprox(const PointView& P,
+                        const ColorView& C,
+                        const WidthView& W,
                         const Options& opt, InternalOpt& inopt,
                         int from, int to);
     
-    void polylineExact(const std::vector<glm::vec2>& P,
-                       const std::vector<ofFloatColor>& C,
-                       const std::vector<float>& W,
+    void polylineExact(const PointView& P,
+                       const ColorView& C,
+                       const WidthView& W,
                        const Options& opt, InternalOpt& inopt,
                        int from, int to);
     
+    static void computeRadii(VertexStream& V, const Options& opt, bool constWeight, float width);
+    
+    static bool isAxisAligned(const PointView& P, const WidthView& W, const Options& opt);
+    void tessellateAxisAligned(const PointView& P, const ColorView& C, float width,
+                               const Options& opt, const InternalOpt& inopt);
+    
+    static bool isHairline(const WidthView& W, const Options& opt);
+    // Whether generator input can go through the stream window unseen
+    static bool canStream(const Options& opt) {
+        return !opt.clip && opt.hairlineWidth <= 0.0f && !opt.pixelSnap;
+    }
+    static size_t hairlineVertexBound(const PointView& points, const Options& opt);
+    
+    void tessellateHairline(const PointView& P,
+                            const ColorView& C,
+                            const WidthView& W,
+                            const Options& opt, const InternalOpt& inopt);
+    
+    // Emits first .. last through pos(i), color(i) and width(i), so spline
+    // samples and input points share it
+    template <class PosAt, class ColorAt, class WidthAt>
+    void hairlineRun(PosAt pos, ColorAt color, WidthAt width, int first, int last,
+                     const Options& opt, bool capFirst, bool capLast);
+    
+    // Emits vertices begin .. end-1 of V[first .. first+n); the rest only give context
+    void polylineExact(const VertexStream& V, int first, int n, const Options& opt,
+                       int begin, int end);
+    
     static void brushArc(VertexArrayHolder& tris,
                          const glm::vec2& center, const ofFloatColor& col,
                          float t, float r,
                          const glm::vec2& N_start, const glm::vec2& N_end,
-                         float wsr);
+                         const Options& opt);
     
     static void segment(StAnchor& SA, const Options& opt,
                         bool capFirst, bool capLast, bool core);
     
     static void segmentLate(const Options& opt,
                             glm::vec2* P, ofFloatColor* C, StPolyline* SL,
-                            VertexArrayHolder& tris,
+                            VertexArrayHolder& tris, VertexArrayHolder& strip,
                             const glm::vec2& cap1, const glm::vec2& cap2, bool core);
     
     static void anchor(StAnchor& SA, const Options& opt, bool capFirst, bool capLast);
@@ -260,7 +661,227 @@ public:
             const ofFloatColor& color, float width,
             const Options& opt = Options());
     
+    // Retessellate into the existing holder, as Polyline::rebuild
+    void rebuild(const glm::vec2& p1, const glm::vec2& p2,
+                 const ofFloatColor& c1, const ofFloatColor& c2,
+                 float w1, float w2,
+                 const Options& opt = Options());
+    
+    void rebuild(const glm::vec2& p1, const glm::vec2& p2,
+                 const ofFloatColor& color, float width,
+                 const Options& opt = Options());
+    
     ofMesh getMesh() const { return holder.toMesh(); }
+    
+private:
+    Polyline line;
+};
+
+// ============================================================================
+// Marker Batch - Anti-aliased discs for scatter plots and handles
+// ============================================================================
+
+// Accumulates filled discs into one triangle holder, for one draw call. Each
+// disc copies a prebuilt unit disc scaled to its radius. The level of detail
+// follows the radius on screen, keeping the edge within 0.25 px of a circle
+// (scaled by opt.arcStep). A disc of radius r has the edge of a stroke 2r
+// wide, so markers on a polyline's vertices line up with its outline.
+class MarkerBatch {
+public:
+    VertexArrayHolder holder;
+    
+    explicit MarkerBatch(std::pmr::memory_resource* mr = nullptr) : holder(mr) {}
+    
+    // One disc per center. radii and colors are per center, or one entry for
+    // all of them. Uses opt's scale, feathering and clip rect.
+    void add(const PointView& centers, const WidthView& radii, const ColorView& colors,
+             const Options& opt = Options());
+    void add(const glm::vec2& center, float radius, const ofFloatColor& color,
+             const Options& opt = Options());
+    
+    void clear() { holder.clear(); discs = 0; }
+    size_t size() const { return discs; }
+    
+    // Vertices add() appends for these radii; exact without a clip rect
+    static size_t estimateVertexCount(size_t count, const WidthView& radii,
+                                      const Options& opt = Options());
+    
+private:
+    struct Shape;  // a disc's radii, level of detail and alpha
+    static Shape shape(float radius, const Options& opt, float feather);
+    
+    size_t discs = 0;
+};
+
+// ============================================================================
+// Streaming - Strokes too long to hold in memory
+// ============================================================================
+
+// Tessellates a stroke fed in chunks of any size. Between chunks only the last
+// few vertices are kept, and triangles reach the sink in batches, so memory use
+// doesn't grow with the stroke's length. The output is that of the per-vertex
+// Polyline constructor, smoothing included; clipping is not applied.
+class PolylineStream {
+public:
+    explicit PolylineStream(VertexSink& sink, const Options& opt = Options());
+    PolylineStream(const PolylineStream&) = delete;
+    PolylineStream& operator=(const PolylineStream&) = delete;
+    
+    // Append points; colors and widths are per point, or one entry for all of them
+    void add(const PointView& points, const ColorView& colors, const WidthView& widths);
+    void add(const glm::vec2& point, const ofFloatColor& color, float width);
+    
+    // Emit the rest of the stroke and flush the sink. add() then starts a new stroke.
+    void finish();
+    
+    size_t getPointCount() const { return pointCount; }
+    
+private:
+    friend class Polyline;
+    
+    // Appends to target's holder instead, using its scratch as the window
+    PolylineStream(Polyline& target, const Options& opt);
+    
+    void push(const glm::vec2& point, const ofFloatColor& color, float width);
+    void smoothSpan(int last);
+    void drain(bool end);
+    
+    Options opt;
+    Polyline own;
+    Polyline& line;  // exact tessellator; its vertex scratch is the window
+    
+    // Last input points, for the spline spans still waiting on a neighbour
+    glm::vec2 recentPoints[4];
+    ofFloatColor recentColors[4];
+    float recentWidths[4];
+    
+    size_t pointCount = 0;
+    bool started = false;  // the window's first vertices have been emitted
+};
+
+template <class Generator>
+void Polyline::rebuild(size_t count, Generator f, const Options& opt) {
+    if (!canStream(opt)) {
+        scratch.points.resize(count);
+        scratch.colors.resize(count);
+        scratch.widths.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            VertexInput v = f(i);
+            scratch.points[i] = v.pos;
+            scratch.colors[i] = v.color;
+            scratch.widths[i] = v.width;
+        }
+        rebuild(PointView(scratch.points.data(), count),
+                ColorView(scratch.colors.data(), count),
+                WidthView(scratch.widths.data(), count), opt);
+        return;
+    }
+    
+    holder.clear();
+    holder.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLES);
+    if (count < 2) return;
+    PolylineStream stream(*this, opt);
+    for (size_t i = 0; i < count; i++) {
+        VertexInput v = f(i);
+        stream.add(v.pos, v.color, v.width);
+    }
+    stream.finish();
+}
+
+// ============================================================================
+// Async - Tessellation on worker threads
+// ============================================================================
+
+// Hands polylines from one producer thread to the render thread. The producer
+// rebuilds back() and publishes it; front() returns the latest published
+// polyline. Three buffers rotate, so neither side ever waits for the other.
+class PolylineSlot {
+public:
+    explicit PolylineSlot(std::pmr::memory_resource* mr = nullptr);
+    
+    PolylineSlot(const PolylineSlot&) = delete;
+    PolylineSlot& operator=(const PolylineSlot&) = delete;
+    
+    // Producer: the polyline to rebuild next, then publish() it
+    Polyline& back() { return buffers[writeIndex]; }
+    void publish();
+    
+    // Consumer: the most recently published polyline (empty before the first)
+    const Polyline& front();
+    
+private:
+    static constexpr int fresh = 4;  // set in middle when it holds an unread polyline
+    
+    Polyline buffers[3];
+    int writeIndex = 0;           // producer only
+    int readIndex = 1;            // consumer only
+    std::atomic<int> middle{2};   // index of the spare buffer | fresh
+};
+
+// Tessellate on another thread. The input and opt are moved into the job, so
+// later changes to the caller's options (or getOptions()) don't reach it.
+// opt.memoryResource, if set, must be safe to use from that thread.
+std::future<Polyline> tessellateAsync(std::vector<glm::vec2> points,
+                                      std::vector<ofFloatColor> colors,
+                                      std::vector<float> widths,
+                                      Options opt = Options());
+
+// Rebuild slot.back() on another thread and publish it. Wait for the previous
+// job on the same slot before starting the next: a slot has one producer.
+std::future<void> tessellateAsync(PolylineSlot& slot,
+                                  std::vector<glm::vec2> points,
+                                  std::vector<ofFloatColor> colors,
+                                  std::vector<float> widths,
+                                  Options opt = Options());
+
+// ============================================================================
+// Instance - One placement of a shared stroke
+// ============================================================================
+
+// A 2D affine transform and a tint: p' = axisX * p.x + axisY * p.y + offset,
+// color' = color * tint
+struct Instance {
+    glm::vec2 axisX{1, 0};
+    glm::vec2 axisY{0, 1};
+    glm::vec2 offset{0, 0};
+    ofFloatColor tint{1, 1, 1, 1};
+    
+    Instance() = default;
+    // Scaled, then rotated by rotation radians, then moved to position
+    explicit Instance(const glm::vec2& position, float rotation = 0.0f, float scale = 1.0f,
+                      const ofFloatColor& tint = ofFloatColor(1, 1, 1, 1))
+        : axisX(std::cos(rotation) * scale, std::sin(rotation) * scale),
+          axisY(-std::sin(rotation) * scale, std::cos(rotation) * scale),
+          offset(position), tint(tint) {}
+    
+    glm::vec2 apply(const glm::vec2& p) const { return axisX * p.x + axisY * p.y + offset; }
+};
+
+// ============================================================================
+// InstancedStroke - A stroke kept on the GPU for drawInstanced
+// ============================================================================
+
+// A copy of a tessellated stroke and, once drawn with GL instancing, a static
+// VBO of it, so drawInstanced uploads only the instances. Keep one per stroke
+// that is drawn again frame after frame, e.g. each icon of a map.
+class InstancedStroke {
+public:
+    InstancedStroke() = default;
+    explicit InstancedStroke(const VertexArrayHolder& holder) { set(holder); }
+    explicit InstancedStroke(const Polyline& polyline) { set(polyline.holder); }
+    
+    // Replace the stroke; it is uploaded again at the next draw. Does nothing
+    // if holder is the stroke already held.
+    void set(const VertexArrayHolder& holder);
+    void set(const Polyline& polyline) { set(polyline.holder); }
+    
+    const VertexArrayHolder& getHolder() const { return holder; }
+    
+private:
+    friend class Renderer;
+    VertexArrayHolder holder;  // also read by the CPU fallback
+    ofVbo vbo;                 // the stroke, and the instances of the last draw
+    bool uploaded = false;
 };
 
 // ============================================================================
@@ -280,9 +901,146 @@ public:
     void draw(const VertexArrayHolder& holder);
     void draw(const Polyline& polyline);
     void draw(const Segment& segment);
+    void draw(const MarkerBatch& markers);
+    void draw(PolylineSlot& slot);  // the latest published polyline
+    
+    // Draw one tessellated stroke count times, once per instance, in one draw
+    // call. Uses GL instancing on programmable GL 3 and GLES 3 renderers, with
+    // the stroke in a static VBO and the instances streamed each call.
+    // Otherwise (GL 2, GLES 2), or with instancing turned off, it transforms
+    // every copy into one batched buffer. The holder and Polyline overloads
+    // keep the last stroke they were given and upload it again only when it
+    // changes; draw several strokes through their own InstancedStrokes.
+    void drawInstanced(InstancedStroke& stroke, const Instance* instances, size_t count);
+    void drawInstanced(InstancedStroke& stroke, const std::vector<Instance>& instances);
+    void drawInstanced(const VertexArrayHolder& holder, const Instance* instances, size_t count);
+    void drawInstanced(const Polyline& polyline, const std::vector<Instance>& instances);
+    
+    void setInstancing(bool enabled) { instancingAllowed = enabled; }
+    bool isInstancing();  // whether drawInstanced uses the GPU path
+    
+    // The CPU fallback: every copy of holder, transformed and tinted, in out.
+    // Strips become triangles; triangles and lines keep their mode.
+    static void transformInstances(const VertexArrayHolder& holder,
+                                   const Instance* instances, size_t count,
+                                   VertexArrayHolder& out);
     
 private:
+    bool setupInstancing();
+    void upload(const VertexArrayHolder& holder);  // and draw, without a capture record
+    
     bool initialized = false;
+    ofVbo vbo;  // reused upload buffer
+    
+    bool instancingAllowed = true;
+    int instancingState = 0;  // 0: not tried yet, 1: ready, -1: unavailable
+    ofShader instanceShader;
+    InstancedStroke lastStroke;  // of the holder and Polyline overloads
+    std::vector<float> instanceAxes, instanceOffsets, instanceTints;  // packed per attribute
+    VertexArrayHolder instanceBatch;  // CPU fallback output
+};
+
+// ============================================================================
+// Tessellation Cache - Skips retessellating strokes drawn again unchanged
+// ============================================================================
+
+// Least recently used cache of tessellated strokes, keyed by a 64-bit hash of the
+// points, colors, widths and options. A hit costs one pass over the input.
+class TessellationCache {
+public:
+    explicit TessellationCache(size_t budgetBytes = 0);
+    
+    // Bytes of geometry to keep, evicting least recently used strokes first.
+    // 0 turns caching off: draw() then tessellates every call.
+    void setBudget(size_t bytes);
+    size_t getBudget() const { return budget; }
+    
+    // Keep cached strokes in static VBOs instead of CPU memory. Clears the cache.
+    void setGpuResident(bool enabled);
+    bool isGpuResident() const { return gpuResident; }
+    
+    // Draw what Polyline(points, ...) would, tessellating only on a miss.
+    // Returns true on a hit.
+    bool draw(Renderer& renderer, const PointView& points,
+              const ofFloatColor& color, float width, const Options& opt);
+    bool draw(Renderer& renderer, const PointView& points,
+              const ColorView& colors, const WidthView& widths, const Options& opt);
+    
+    void clear();
+    void resetStats() { hits = 0; misses = 0; }
+    
+    size_t getHits() const { return hits; }
+    size_t getMisses() const { return misses; }
+    size_t getBytes() const { return bytes; }
+    size_t size() const { return entries.size(); }
+    
+private:
+    struct Entry {
+        uint64_t hash = 0;
+        size_t count = 0;  // input points, compared along with the hash
+        size_t bytes = 0;
+        VertexArrayHolder holder;
+        ofVbo vbo;
+        int vboCount = 0;
+    };
+    
+    template <class Tessellate>
+    bool draw(Renderer& renderer, uint64_t hash, size_t count, Tessellate tessellate);
+    void erase(std::list<Entry>::iterator it);
+    
+    std::list<Entry> entries;  // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    Polyline line;  // tessellates misses into reused buffers
+    size_t budget = 0;
+    size_t bytes = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    bool gpuResident = false;
+};
+
+// ============================================================================
+// Quality Controller - Keeps frames inside a vertex or time budget
+// ============================================================================
+
+// Picks a Quality per frame: one step down as soon as a frame goes over
+// budget, one step back up after frames have stayed well under it for a
+// while. Apply it to a copy of the options every frame:
+//
+//     quality.beginFrame();
+//     ofxVase::Options opt = quality.apply(baseOptions);
+//     ... tessellate and draw with opt, adding up the vertices ...
+//     quality.endFrame(vertices);
+class QualityController {
+public:
+    // Per frame; 0 leaves that measure unbounded
+    void setVertexBudget(size_t vertices) { vertexBudget = vertices; }
+    void setTimeBudget(double seconds) { timeBudget = seconds; }
+    
+    // Levels to move between, Draft to Normal by default
+    void setRange(Quality lowest, Quality highest);
+    // Frames in a row under fraction of the budget before stepping up
+    void setRestore(int frames, float fraction = 0.7f);
+    
+    // Times the frame itself, or takes the frame's seconds from the caller
+    void beginFrame();
+    void endFrame(size_t vertices);
+    void endFrame(size_t vertices, double seconds);
+    
+    Quality getQuality() const { return quality; }
+    void setQuality(Quality q) { quality = q; calmFrames = 0; }
+    // opt at the current level
+    Options apply(Options opt) const;
+    
+private:
+    size_t vertexBudget = 0;
+    double timeBudget = 0;
+    Quality lowest = Quality::Draft;
+    Quality highest = Quality::Normal;
+    Quality quality = Quality::Normal;
+    int restoreFrames = 30;
+    float restoreFraction = 0.7f;
+    int calmFrames = 0;
+    std::chrono::steady_clock::time_point frameStart;
 };
 
 // ============================================================================
@@ -302,6 +1060,8 @@ namespace util {
                   glm::vec2& out, float* pts = nullptr);
     bool intersecting(const glm::vec2& a, const glm::vec2& b,
                       const glm::vec2& c, const glm::vec2& d);
+    bool segmentIntersectsRect(const glm::vec2& a, const glm::vec2& b,
+                               const glm::vec2& lo, const glm::vec2& hi);
     
     ofFloatColor colorBetween(const ofFloatColor& a, const ofFloatColor& b, float t);
     
@@ -315,6 +1075,20 @@ namespace util {
                         std::vector<glm::vec2>& outPoints,
                         std::vector<ofFloatColor>& outColors,
                         std::vector<float>& outWidths);
+    
+    // Subdivisions needed to keep the p1-p2 span within tolerance of its chords
+    int smoothingSubdivisions(const glm::vec2& p0, const glm::vec2& p1,
+                              const glm::vec2& p2, const glm::vec2& p3,
+                              float tolerance, int maxSubdivisions);
+    
+    // Like smoothPolyline, but picks subdivisions per segment from a flatness tolerance
+    void smoothPolylineAdaptive(const std::vector<glm::vec2>& points,
+                                const std::vector<ofFloatColor>& colors,
+                                const std::vector<float>& widths,
+                                float tolerance, int maxSubdivisions,
+                                std::vector<glm::vec2>& outPoints,
+                                std::vector<ofFloatColor>& outColors,
+                                std::vector<float>& outWidths);
 }
 
 // ============================================================================
@@ -323,6 +1097,7 @@ namespace util {
 
 void draw(const ofPolyline& polyline, float width = 2.0f);
 void draw(const ofPolyline& polyline, const ofColor& color, float width = 2.0f);
+// Color and width lists shorter than the polyline are padded with their last entry
 void draw(const ofPolyline& polyline, const ofColor& color, 
           const std::vector<float>& widths);
 void draw(const ofPolyline& polyline, 
@@ -339,9 +1114,28 @@ void drawLine(const glm::vec2& p1, const glm::vec2& p2,
               const ofColor& c1, const ofColor& c2,
               float width1, float width2);
 
+// Filled discs of the given radius, in one draw call
+void drawPoints(const std::vector<glm::vec2>& centers, float radius = 3.0f);
+void drawPoints(const std::vector<glm::vec2>& centers, const ofColor& color, float radius = 3.0f);
+void drawPoints(const std::vector<glm::vec2>& centers,
+                const std::vector<ofColor>& colors,
+                const std::vector<float>& radii);
+
+// Outline, pixel-snapped whatever getOptions().pixelSnap says
+void drawRect(const ofRectangle& rect, float width = 1.0f);
+void drawRect(const ofRectangle& rect, const ofColor& color, float width = 1.0f);
+
 void setJointStyle(JointStyle style);
 void setCapStyle(CapStyle style);
 void setFeather(bool enabled, float amount = 1.0f);
+void setQuality(Quality q);
+
+// The options used by the functions above, shared by all threads; copy them
+// into the Options of worker jobs rather than reading them there
 Options& getOptions();
 
+// Cache for the draw(ofPolyline, ...) functions, off until given a byte budget
+void setCacheBudget(size_t bytes);
+TessellationCache& getCache();
+
 } // namespace ofxVase
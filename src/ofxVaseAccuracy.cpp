@@ -0,0 +1,193 @@
+#include "ofxVaseAccuracy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace ofxVase {
+
+AccuracyHarness::AccuracyHarness(int width, int height, int samples)
+    : width(std::max(0, width)), height(std::max(0, height)) {
+    setSamples(samples);
+}
+
+double AccuracyHarness::sweptDiscDistance(const glm::vec2& q, const glm::vec2& a, float ra,
+                                          const glm::vec2& b, float rb) {
+    double bax = b.x - a.x, bay = b.y - a.y;
+    double pax = q.x - a.x, pay = q.y - a.y;
+    double l2 = bax * bax + bay * bay;
+    double rr = static_cast<double>(ra) - rb;
+    double a2 = l2 - rr * rr;
+
+    // One disc inside the other: the larger one is the whole stroke
+    if (a2 <= 0.0) {
+        double qbx = q.x - b.x, qby = q.y - b.y;
+        return std::min(std::sqrt(pax * pax + pay * pay) - ra, std::sqrt(qbx * qbx + qby * qby) - rb);
+    }
+
+    // Rounded cone: the discs' outer tangents split the plane into the part
+    // closest to disc a, to disc b and to the tangent lines between them
+    double il2 = 1.0 / l2;
+    double y = pax * bax + pay * bay;
+    double z = y - l2;
+    double xx = pax * l2 - bax * y, xy = pay * l2 - bay * y;
+    double x2 = xx * xx + xy * xy;
+    double y2 = y * y * l2;
+    double z2 = z * z * l2;
+    double k = (rr > 0 ? 1.0 : rr < 0 ? -1.0 : 0.0) * rr * rr * x2;
+    if ((z > 0 ? 1.0 : z < 0 ? -1.0 : 0.0) * a2 * z2 > k) return std::sqrt(x2 + z2) * il2 - rb;
+    if ((y > 0 ? 1.0 : y < 0 ? -1.0 : 0.0) * a2 * y2 < k) return std::sqrt(x2 + y2) * il2 - ra;
+    return (std::sqrt(x2 * a2 * il2) + y * rr) * il2 - ra;
+}
+
+void AccuracyHarness::referenceCoverage(const std::vector<glm::vec2>& points,
+                                        const std::vector<float>& radii) {
+    // One bit per sample; a pixel is done once all of its bits are set
+    int perPixel = samples * samples;
+    uint64_t full = perPixel == 64 ? ~uint64_t(0) : (uint64_t(1) << perPixel) - 1;
+    std::vector<uint64_t> covered(static_cast<size_t>(width) * height, 0);
+
+    // Threads own bands of rows and walk every segment over their band
+    auto band = [&](int y0, int y1) {
+        for (size_t s = 0; s + 1 < points.size(); s++) {
+            const glm::vec2& a = points[s];
+            const glm::vec2& b = points[s + 1];
+            float ra = radii[s], rb = radii[s + 1];
+            int left = static_cast<int>(std::floor(std::min(a.x - ra, b.x - rb)));
+            int right = static_cast<int>(std::ceil(std::max(a.x + ra, b.x + rb)));
+            int top = static_cast<int>(std::floor(std::min(a.y - ra, b.y - rb)));
+            int bottom = static_cast<int>(std::ceil(std::max(a.y + ra, b.y + rb)));
+            left = std::max(left, 0);
+            right = std::min(right, width);
+            top = std::max(top, y0);
+            bottom = std::min(bottom, y1);
+
+            for (int y = top; y < bottom; y++) {
+                for (int x = left; x < right; x++) {
+                    uint64_t& mask = covered[static_cast<size_t>(y) * width + x];
+                    if (mask == full) continue;
+                    for (int i = 0; i < perPixel; i++) {
+                        uint64_t bit = uint64_t(1) << i;
+                        if (mask & bit) continue;
+                        glm::vec2 q(x + (i % samples + 0.5f) / samples, y + (i / samples + 0.5f) / samples);
+                        if (sweptDiscDistance(q, a, ra, b, rb) <= 0.0) mask |= bit;
+                    }
+                }
+            }
+        }
+    };
+
+    int threads = threadCount > 0 ? threadCount
+                                  : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threads = std::max(1, std::min(threads, height));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.emplace_back(band, height * t / threads, height * (t + 1) / threads);
+    }
+    band(0, height / threads);
+    for (auto& thread : pool) thread.join();
+
+    reference.resize(covered.size());
+    for (size_t i = 0; i < covered.size(); i++) {
+        int bits = 0;
+        for (uint64_t m = covered[i]; m; m &= m - 1) bits++;
+        reference[i] = static_cast<float>(bits) / perPixel;
+    }
+}
+
+AccuracyReport AccuracyHarness::measure(const PointView& points, const WidthView& widths,
+                                        const Options& opt) {
+    AccuracyReport report;
+    size_t n = points.size();
+    float scale = opt.worldToScreenRatio;
+    if (widths.empty()) return report;
+
+    // One width, or one per point; a shorter list is padded with its last entry
+    auto widthAt = [&](size_t i) { return widths[std::min(i, widths.size() - 1)]; };
+    std::vector<float> padded;
+    WidthView strokeWidths = widths;
+    if (widths.size() > 1 && widths.size() < n) {
+        padded.resize(n);
+        for (size_t i = 0; i < n; i++) padded[i] = widthAt(i);
+        strokeWidths = padded;
+    }
+
+    // Output: a white stroke over opaque black, so red is the coverage seen on screen
+    ofFloatColor white(1, 1, 1, 1);
+    Polyline polyline(points, ColorView(&white, 1), strokeWidths, opt);
+    VertexArrayHolder screen = polyline.holder;
+    for (glm::vec3& v : screen.vertices) {
+        v.x *= scale;
+        v.y *= scale;
+    }
+
+    Rasterizer raster(width, height);
+    raster.setThreadCount(threadCount);
+    raster.clear(ofFloatColor(0, 0, 0, 1));
+    raster.draw(screen);
+    raster.finish();
+    output.assign(raster.getChannel(0), raster.getChannel(0) + static_cast<size_t>(width) * height);
+
+    OverdrawAnalyzer overdraw(width, height);
+    overdraw.setThreadCount(threadCount);
+    overdraw.add(screen);
+    report.overdraw = overdraw.getStats();
+
+    // Reference: the path the output follows, in canvas pixels
+    std::vector<glm::vec2> path(n);
+    std::vector<float> radii(n);
+    for (size_t i = 0; i < n; i++) {
+        path[i] = points[i] * scale;
+        radii[i] = widthAt(i) * scale * 0.5f;
+    }
+    if (opt.smoothing > 0 && n > 2) {
+        std::vector<ofFloatColor> colors(n, white), smoothColors;
+        std::vector<glm::vec2> smoothPath;
+        std::vector<float> diameters(n), smoothDiameters;
+        for (size_t i = 0; i < n; i++) diameters[i] = radii[i] * 2.0f;
+        util::smoothPolyline(path, colors, diameters, 64, smoothPath, smoothColors, smoothDiameters);
+        path.swap(smoothPath);
+        radii.resize(smoothDiameters.size());
+        for (size_t i = 0; i < radii.size(); i++) radii[i] = smoothDiameters[i] * 0.5f;
+    }
+    if (n > 1) {
+        referenceCoverage(path, radii);
+    } else {
+        reference.assign(output.size(), 0.0f);
+    }
+
+    double sumSquares = 0, sumReference = 0, sumOutput = 0;
+    for (size_t i = 0; i < reference.size(); i++) {
+        float r = reference[i];
+        float o = output[i];
+        if (r <= 0.0f && o <= 0.0f) continue;
+        float error = std::fabs(o - r);
+        report.comparedPixels++;
+        report.maxError = std::max(report.maxError, error);
+        sumSquares += static_cast<double>(error) * error;
+        sumReference += r;
+        sumOutput += o;
+        if (r >= 1.0f && o < 0.5f) report.gapPixels++;
+    }
+    if (report.comparedPixels) {
+        report.rmsError = static_cast<float>(std::sqrt(sumSquares / report.comparedPixels));
+    }
+    if (sumReference > 0) {
+        report.inkRatio = static_cast<float>(sumOutput / sumReference);
+    }
+    return report;
+}
+
+void AccuracyHarness::getErrorMap(ofPixels& pixels) const {
+    pixels.allocate(width, height, OF_PIXELS_RGBA);
+    unsigned char* out = pixels.getData();
+    for (size_t i = 0; i < reference.size(); i++) {
+        float d = output[i] - reference[i];
+        out[i * 4 + 0] = static_cast<unsigned char>(std::min(std::max(d, 0.0f), 1.0f) * 255.0f + 0.5f);
+        out[i * 4 + 1] = 0;
+        out[i * 4 + 2] = static_cast<unsigned char>(std::min(std::max(-d, 0.0f), 1.0f) * 255.0f + 0.5f);
+        out[i * 4 + 3] = 255;
+    }
+}
+
+} // namespace ofxVase
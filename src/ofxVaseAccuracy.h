@@ -0,0 +1,70 @@
+#pragma once
+/*
+ * ofxVase - Accuracy harness
+ *
+ * Measures how far tessellated output is from the stroke it stands for. The
+ * reference is the union of discs swept along the polyline, radius half the
+ * width, interpolated linearly per segment: a stroke with round joints and
+ * caps. Its coverage is supersampled per pixel and compared with the coverage
+ * the Rasterizer gets from ofxVase output drawn in white over black, which is
+ * what the screen shows, fade strips and overlaps included.
+ *
+ * Square or butt caps and miter or bevel joints differ from the round
+ * reference by design; their error is the shape difference plus the
+ * tessellation's. With smoothing, the reference follows the Catmull-Rom curve
+ * at 64 subdivisions per segment.
+ */
+
+#include "ofxVaseRaster.h"
+
+namespace ofxVase {
+
+struct AccuracyReport {
+    float maxError = 0;          // largest |output - reference| coverage of a pixel
+    float rmsError = 0;          // over the compared pixels
+    int comparedPixels = 0;      // pixels that either covers
+    int gapPixels = 0;           // fully covered by the reference, under half by the output
+    float inkRatio = 0;          // output coverage / reference coverage, summed
+    OverdrawAnalyzer::Stats overdraw;
+};
+
+class AccuracyHarness {
+public:
+    // Canvas in pixels; samples per axis (1 to 8) for the reference coverage
+    AccuracyHarness(int width, int height, int samples = 8);
+
+    void setSamples(int perAxis) { samples = std::min(std::max(perAxis, 1), 8); }
+    void setThreadCount(int threads) { threadCount = threads; }
+
+    // Tessellate points / widths with opt and compare. Points are in world
+    // units; opt.worldToScreenRatio maps them to canvas pixels. widths has one
+    // entry or one per point; a shorter list is padded with its last entry.
+    AccuracyReport measure(const PointView& points, const WidthView& widths,
+                           const Options& opt = Options());
+
+    // Per-pixel coverage of the last measure(), width * height, rows top down
+    const std::vector<float>& getReferenceCoverage() const { return reference; }
+    const std::vector<float>& getOutputCoverage() const { return output; }
+
+    // Opaque difference image of the last measure(): red where the output has
+    // too much coverage, blue where too little, black where they agree
+    void getErrorMap(ofPixels& pixels) const;
+
+    // Signed distance from q to the discs swept linearly from (a, ra) to
+    // (b, rb), evaluated in double; negative inside
+    static double sweptDiscDistance(const glm::vec2& q, const glm::vec2& a, float ra,
+                                    const glm::vec2& b, float rb);
+
+private:
+    void referenceCoverage(const std::vector<glm::vec2>& points, const std::vector<float>& radii);
+
+    int width;
+    int height;
+    int samples;
+    int threadCount = 0;
+
+    std::vector<float> reference;
+    std::vector<float> output;
+};
+
+} // namespace ofxVase
@@ -0,0 +1,442 @@
+#include "ofxVaseBatch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OFXVASE_SSE2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define OFXVASE_AVX2 1
+#endif
+
+namespace ofxVase {
+namespace batch {
+
+namespace {
+
+inline int countBits(int bits) {
+    int n = 0;
+    for (; bits; bits &= bits - 1) n++;
+    return n;
+}
+
+// ============================================================================
+// Lane types
+// ============================================================================
+
+struct ScalarMask { bool m; };
+
+struct Scalar {
+    static constexpr int width = 1;
+    float v;
+
+    static Scalar load(const float* p) { return { *p }; }
+    static Scalar splat(float s) { return { s }; }
+    static ScalarMask loadMask(const int32_t* p) { return { *p != 0 }; }
+};
+
+inline void store(float* p, Scalar a) { *p = a.v; }
+inline void storeMask(int32_t* p, ScalarMask m) { *p = m.m ? -1 : 0; }
+inline Scalar operator+(Scalar a, Scalar b) { return { a.v + b.v }; }
+inline Scalar operator-(Scalar a, Scalar b) { return { a.v - b.v }; }
+inline Scalar operator*(Scalar a, Scalar b) { return { a.v * b.v }; }
+inline Scalar operator/(Scalar a, Scalar b) { return { a.v / b.v }; }
+inline ScalarMask operator<(Scalar a, Scalar b) { return { a.v < b.v }; }
+inline ScalarMask operator>(Scalar a, Scalar b) { return { a.v > b.v }; }
+inline ScalarMask operator>=(Scalar a, Scalar b) { return { a.v >= b.v }; }
+inline ScalarMask operator&(ScalarMask a, ScalarMask b) { return { a.m && b.m }; }
+inline ScalarMask operator|(ScalarMask a, ScalarMask b) { return { a.m || b.m }; }
+inline ScalarMask operator!(ScalarMask a) { return { !a.m }; }
+inline bool any(ScalarMask a) { return a.m; }
+inline int count(ScalarMask a) { return a.m ? 1 : 0; }
+inline Scalar select(ScalarMask m, Scalar a, Scalar b) { return m.m ? a : b; }
+inline Scalar sqrt(Scalar a) { return { std::sqrt(a.v) }; }
+inline Scalar abs(Scalar a) { return { std::fabs(a.v) }; }
+inline Scalar floor(Scalar a) { return { std::floor(a.v) }; }
+inline Scalar min(Scalar a, Scalar b) { return { std::min(a.v, b.v) }; }
+inline Scalar max(Scalar a, Scalar b) { return { std::max(a.v, b.v) }; }
+
+#ifdef OFXVASE_SSE2
+
+struct SseMask { __m128 m; };
+
+struct Sse {
+    static constexpr int width = 4;
+    __m128 v;
+
+    static Sse load(const float* p) { return { _mm_loadu_ps(p) }; }
+    static Sse splat(float s) { return { _mm_set1_ps(s) }; }
+    static SseMask loadMask(const int32_t* p) {
+        __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i zero = _mm_cmpeq_epi32(m, _mm_setzero_si128());
+        return { _mm_castsi128_ps(_mm_xor_si128(zero, _mm_set1_epi32(-1))) };
+    }
+};
+
+inline void store(float* p, Sse a) { _mm_storeu_ps(p, a.v); }
+inline void storeMask(int32_t* p, SseMask m) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_castps_si128(m.m));
+}
+inline Sse operator+(Sse a, Sse b) { return { _mm_add_ps(a.v, b.v) }; }
+inline Sse operator-(Sse a, Sse b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline Sse operator*(Sse a, Sse b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline Sse operator/(Sse a, Sse b) { return { _mm_div_ps(a.v, b.v) }; }
+inline SseMask operator<(Sse a, Sse b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline SseMask operator>(Sse a, Sse b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+inline SseMask operator>=(Sse a, Sse b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+inline SseMask operator&(SseMask a, SseMask b) { return { _mm_and_ps(a.m, b.m) }; }
+inline SseMask operator|(SseMask a, SseMask b) { return { _mm_or_ps(a.m, b.m) }; }
+inline SseMask operator!(SseMask a) { return { _mm_xor_ps(a.m, _mm_castsi128_ps(_mm_set1_epi32(-1))) }; }
+inline bool any(SseMask a) { return _mm_movemask_ps(a.m) != 0; }
+inline int count(SseMask a) { return countBits(_mm_movemask_ps(a.m)); }
+inline Sse select(SseMask m, Sse a, Sse b) {
+    return { _mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v)) };
+}
+inline Sse sqrt(Sse a) { return { _mm_sqrt_ps(a.v) }; }
+inline Sse abs(Sse a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+inline Sse min(Sse a, Sse b) { return { _mm_min_ps(a.v, b.v) }; }
+inline Sse max(Sse a, Sse b) { return { _mm_max_ps(a.v, b.v) }; }
+inline Sse floor(Sse a) {
+#if defined(__SSE4_1__)
+    return { _mm_floor_ps(a.v) };
+#else
+    // Truncate, then step down where truncation rounded up (negative inputs)
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    return { _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f))) };
+#endif
+}
+
+#endif // OFXVASE_SSE2
+
+#ifdef OFXVASE_AVX2
+
+struct AvxMask { __m256 m; };
+
+struct Avx {
+    static constexpr int width = 8;
+    __m256 v;
+
+    static Avx load(const float* p) { return { _mm256_loadu_ps(p) }; }
+    static Avx splat(float s) { return { _mm256_set1_ps(s) }; }
+    static AvxMask loadMask(const int32_t* p) {
+        __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i zero = _mm256_cmpeq_epi32(m, _mm256_setzero_si256());
+        return { _mm256_castsi256_ps(_mm256_xor_si256(zero, _mm256_set1_epi32(-1))) };
+    }
+};
+
+inline void store(float* p, Avx a) { _mm256_storeu_ps(p, a.v); }
+inline void storeMask(int32_t* p, AvxMask m) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_castps_si256(m.m));
+}
+inline Avx operator+(Avx a, Avx b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline Avx operator-(Avx a, Avx b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline Avx operator*(Avx a, Avx b) { return { _mm256_mul_ps(a.v, b.v) }; }
+inline Avx operator/(Avx a, Avx b) { return { _mm256_div_ps(a.v, b.v) }; }
+inline AvxMask operator<(Avx a, Avx b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline AvxMask operator>(Avx a, Avx b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+inline AvxMask operator>=(Avx a, Avx b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+inline AvxMask operator&(AvxMask a, AvxMask b) { return { _mm256_and_ps(a.m, b.m) }; }
+inline AvxMask operator|(AvxMask a, AvxMask b) { return { _mm256_or_ps(a.m, b.m) }; }
+inline AvxMask operator!(AvxMask a) {
+    return { _mm256_xor_ps(a.m, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) };
+}
+inline bool any(AvxMask a) { return _mm256_movemask_ps(a.m) != 0; }
+inline int count(AvxMask a) { return countBits(_mm256_movemask_ps(a.m)); }
+inline Avx select(AvxMask m, Avx a, Avx b) { return { _mm256_blendv_ps(b.v, a.v, m.m) }; }
+inline Avx sqrt(Avx a) { return { _mm256_sqrt_ps(a.v) }; }
+inline Avx abs(Avx a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+inline Avx floor(Avx a) { return { _mm256_floor_ps(a.v) }; }
+inline Avx min(Avx a, Avx b) { return { _mm256_min_ps(a.v, b.v) }; }
+inline Avx max(Avx a, Avx b) { return { _mm256_max_ps(a.v, b.v) }; }
+
+#endif // OFXVASE_AVX2
+
+#if defined(OFXVASE_AVX2)
+using Wide = Avx;
+#elif defined(OFXVASE_SSE2)
+using Wide = Sse;
+#else
+using Wide = Scalar;
+#endif
+
+// ============================================================================
+// Kernels, written once per lane type. Each processes whole lanes from i and
+// returns where it stopped; the scalar instantiation finishes the remainder.
+// ============================================================================
+
+template <class F>
+int determineTrLanes(const float* w, float* t, float* r, int i, int n,
+                     float scale, float feather) {
+    const F vscale = F::splat(scale);
+    const F vfeather = F::splat(feather);
+
+    for (; i + F::width <= n; i += F::width) {
+        F ww = F::load(w + i) * vscale;
+        F f = ww - floor(ww);
+        auto in = [&](float lo, float hi) {
+            return (ww >= F::splat(lo)) & (ww < F::splat(hi));
+        };
+
+        // Anything outside [1, inf), including NaN, keeps the sub-pixel entry
+        F tt = F::splat(0.05f);
+        F rr = F::splat(0.768f);
+
+        auto m1 = in(1.0f, 2.0f);
+        tt = select(m1, F::splat(0.05f) + f * F::splat(0.33f), tt);
+        rr = select(m1, F::splat(0.768f) + F::splat(0.312f) * f, rr);
+        tt = select(in(2.0f, 3.0f), F::splat(0.38f) + f * F::splat(0.58f), tt);
+        tt = select(in(3.0f, 4.0f), F::splat(0.96f) + f * F::splat(0.48f), tt);
+        tt = select(in(4.0f, 5.0f), F::splat(1.44f) + f * F::splat(0.46f), tt);
+        tt = select(in(5.0f, 6.0f), F::splat(1.9f) + f * F::splat(0.6f), tt);
+        tt = select(ww >= F::splat(6.0f),
+                    F::splat(2.5f) + (ww - F::splat(6.0f)) * F::splat(0.50f), tt);
+        rr = select(ww >= F::splat(2.0f), F::splat(1.08f), rr);
+
+        store(t + i, tt / vscale);
+        store(r + i, rr / vscale * vfeather);
+    }
+    return i;
+}
+
+template <class F>
+int segmentTangentLanes(const float* x, const float* y, const float* t, const float* r,
+                        int i, int count,
+                        float* ntx, float* nty, float* nbx, float* nby, int32_t* degenerate) {
+    for (; i + F::width <= count; i += F::width) {
+        F dx = F::load(x + i + 1) - F::load(x + i);
+        F dy = F::load(y + i + 1) - F::load(y + i);
+        F d = sqrt(dx * dx + dy * dy);
+
+        F R1 = F::load(t + i) + F::load(r + i);
+        F R2 = F::load(t + i + 1) + F::load(r + i + 1);
+
+        auto degen = (d < F::splat(0.001f)) | (d < abs(R1 - R2));
+
+        F ux = dx / d;
+        F uy = dy / d;
+        F sinA = min(max((R1 - R2) / d, F::splat(-0.999f)), F::splat(0.999f));
+        F cosA = sqrt(F::splat(1.0f) - sinA * sinA);
+
+        // N = sinA * u +- cosA * perp(u), perp(u) = (-uy, ux)
+        F nux = F::splat(0.0f) - uy;
+        F topX = sinA * ux + cosA * nux;
+        F topY = sinA * uy + cosA * ux;
+        F botX = sinA * ux - cosA * nux;
+        F botY = sinA * uy - cosA * ux;
+
+        store(ntx + i, select(degen, F::splat(0.0f), topX));
+        store(nty + i, select(degen, F::splat(1.0f), topY));
+        store(nbx + i, select(degen, F::splat(0.0f), botX));
+        store(nby + i, select(degen, F::splat(-1.0f), botY));
+        storeMask(degenerate + i, degen);
+    }
+    return i;
+}
+
+template <class F, class M>
+void lineIsectLanes(F p1x, F p1y, F d1x, F d1y, F p2x, F p2y, F d2x, F d2y,
+                    F& outX, F& outY, M& ok) {
+    F det = d1x * d2y - d1y * d2x;
+    ok = !(abs(det) < F::splat(1e-8f));
+    F dpx = p2x - p1x;
+    F dpy = p2y - p1y;
+    F s = (dpx * d2y - dpy * d2x) / det;
+    outX = p1x + s * d1x;
+    outY = p1y + s * d1y;
+}
+
+template <class F>
+int innerMiterLanes(const float* x, const float* y, const float* t, const float* r,
+                    const float* ntx, const float* nty, const float* nbx, const float* nby,
+                    const int32_t* degenerate, int i, int end,
+                    float* coreX, float* coreY, float* fadeX, float* fadeY,
+                    int32_t* valid, int32_t* topInner) {
+    for (; i + F::width <= end; i += F::width) {
+        F px = F::load(x + i - 1), py = F::load(y + i - 1);
+        F cx = F::load(x + i),     cy = F::load(y + i);
+        F nx = F::load(x + i + 1), ny = F::load(y + i + 1);
+        F pt = F::load(t + i - 1), ct = F::load(t + i), nt = F::load(t + i + 1);
+        F pr = F::load(r + i - 1), cr = F::load(r + i), nr = F::load(r + i + 1);
+
+        F cross = (cx - px) * (ny - cy) - (cy - py) * (nx - cx);
+        auto top = cross > F::splat(0.0f);
+
+        F Npx = select(top, F::load(ntx + i - 1), F::load(nbx + i - 1));
+        F Npy = select(top, F::load(nty + i - 1), F::load(nby + i - 1));
+        F Nnx = select(top, F::load(ntx + i), F::load(nbx + i));
+        F Nny = select(top, F::load(nty + i), F::load(nby + i));
+
+        // Core: offset edges of both segments at the core radius
+        F pAx = cx + ct * Npx, pAy = cy + ct * Npy;
+        F dAx = pAx - (px + pt * Npx), dAy = pAy - (py + pt * Npy);
+        F pBx = cx + ct * Nnx, pBy = cy + ct * Nny;
+        F dBx = (nx + nt * Nnx) - pBx, dBy = (ny + nt * Nny) - pBy;
+
+        F ix, iy;
+        decltype(top) hit;
+        lineIsectLanes(pAx, pAy, dAx, dAy, pBx, pBy, dBx, dBy, ix, iy, hit);
+
+        F ox = ix - cx, oy = iy - cy;
+        F dist = sqrt(ox * ox + oy * oy);
+        F side = ox * (Npx + Nnx) + oy * (Npy + Nny);
+        F R = ct + cr;
+        auto ok = hit & (side > F::splat(0.0f)) & (dist < F::splat(3.0f) * R)
+                & !F::loadMask(degenerate + i - 1) & !F::loadMask(degenerate + i);
+
+        // Fade: same construction at the outer radius, falling back to the
+        // core miter direction when the fade edges are parallel
+        F fpAx = cx + R * Npx, fpAy = cy + R * Npy;
+        F fdAx = fpAx - (px + (pt + pr) * Npx), fdAy = fpAy - (py + (pt + pr) * Npy);
+        F fpBx = cx + R * Nnx, fpBy = cy + R * Nny;
+        F fdBx = (nx + (nt + nr) * Nnx) - fpBx, fdBy = (ny + (nt + nr) * Nny) - fpBy;
+
+        F fx, fy;
+        decltype(top) fhit;
+        lineIsectLanes(fpAx, fpAy, fdAx, fdAy, fpBx, fpBy, fdBx, fdBy, fx, fy, fhit);
+        fx = select(fhit, fx, cx + R * (ox / dist));
+        fy = select(fhit, fy, cy + R * (oy / dist));
+
+        store(coreX + i, ix);
+        store(coreY + i, iy);
+        store(fadeX + i, fx);
+        store(fadeY + i, fy);
+        storeMask(valid + i, ok);
+        storeMask(topInner + i, top);
+    }
+    return i;
+}
+
+template <class F>
+int rasterRowLanes(const RasterTriangle& tri, float py, int x0, int x1,
+                   float* r, float* g, float* b, float* a, float* layers) {
+    static const float centres[8] = { 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f };
+    const F lane = F::load(centres);
+    const F zero = F::splat(0.0f);
+    const F one = F::splat(1.0f);
+    const F end = F::splat(static_cast<float>(x1));
+
+    // Row-constant parts of the edge functions and color planes
+    F e0y = F::splat(tri.b[0] * py + tri.c[0]);
+    F e1y = F::splat(tri.b[1] * py + tri.c[1]);
+    F e2y = F::splat(tri.b[2] * py + tri.c[2]);
+    float dy = py - tri.originY;
+    F ry = F::splat(tri.red[1] * dy + tri.red[2]);
+    F gy = F::splat(tri.green[1] * dy + tri.green[2]);
+    F by = F::splat(tri.blue[1] * dy + tri.blue[2]);
+    F ay = F::splat(tri.alpha[1] * dy + tri.alpha[2]);
+
+    // Whole lanes only: the last group is masked at x1 instead of finished by
+    // a scalar loop, since most spans of a thin stroke are shorter than a lane
+    int covered = 0;
+    for (int i = x0; i < x1; i += F::width) {
+        F px = F::splat(static_cast<float>(i)) + lane;
+        F e0 = F::splat(tri.a[0]) * px + e0y;
+        F e1 = F::splat(tri.a[1]) * px + e1y;
+        F e2 = F::splat(tri.a[2]) * px + e2y;
+
+        // Top-left rule: a pixel centre on a shared edge belongs to exactly one
+        // of the two triangles, so seams are neither blended twice nor dropped
+        auto in0 = tri.topLeft[0] ? e0 >= zero : e0 > zero;
+        auto in1 = tri.topLeft[1] ? e1 >= zero : e1 > zero;
+        auto in2 = tri.topLeft[2] ? e2 >= zero : e2 > zero;
+        auto inside = in0 & in1 & in2 & (px < end);
+        if (!any(inside)) continue;
+        covered += count(inside);
+
+        F dx = px - F::splat(tri.originX);
+        F sr = min(max(F::splat(tri.red[0]) * dx + ry, zero), one);
+        F sg = min(max(F::splat(tri.green[0]) * dx + gy, zero), one);
+        F sb = min(max(F::splat(tri.blue[0]) * dx + by, zero), one);
+        F sa = min(max(F::splat(tri.alpha[0]) * dx + ay, zero), one);
+        F keep = one - sa;
+
+        // GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA on all four channels
+        int o = i - x0;
+        F dr = F::load(r + o), dg = F::load(g + o), db = F::load(b + o), da = F::load(a + o);
+        store(r + o, select(inside, sr * sa + dr * keep, dr));
+        store(g + o, select(inside, sg * sa + dg * keep, dg));
+        store(b + o, select(inside, sb * sa + db * keep, db));
+        store(a + o, select(inside, sa * sa + da * keep, da));
+
+        if (layers) {
+            F dl = F::load(layers + o);
+            store(layers + o, select(inside, dl + one, dl));
+        }
+    }
+    return covered;
+}
+
+} // namespace
+
+const char* instructionSet() {
+#if defined(OFXVASE_AVX2)
+    return "AVX2";
+#elif defined(OFXVASE_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void determineTr(const float* w, float* t, float* r, int n, float scale, float feather) {
+    int i = determineTrLanes<Wide>(w, t, r, 0, n, scale, feather);
+    determineTrLanes<Scalar>(w, t, r, i, n, scale, feather);
+}
+
+void segmentTangents(const float* x, const float* y, const float* t, const float* r, int n,
+                     float* ntx, float* nty, float* nbx, float* nby, int32_t* degenerate) {
+    int count = n - 1;
+    int i = segmentTangentLanes<Wide>(x, y, t, r, 0, count, ntx, nty, nbx, nby, degenerate);
+    segmentTangentLanes<Scalar>(x, y, t, r, i, count, ntx, nty, nbx, nby, degenerate);
+}
+
+void innerMiters(const float* x, const float* y, const float* t, const float* r,
+                 const float* ntx, const float* nty, const float* nbx, const float* nby,
+                 const int32_t* degenerate, int n,
+                 float* coreX, float* coreY, float* fadeX, float* fadeY,
+                 int32_t* valid, int32_t* topInner) {
+    if (n < 1) return;
+    valid[0] = 0;
+    topInner[0] = 0;
+    valid[n - 1] = 0;
+    topInner[n - 1] = 0;
+
+    int end = n - 1;
+    int i = innerMiterLanes<Wide>(x, y, t, r, ntx, nty, nbx, nby, degenerate, 1, end,
+                                  coreX, coreY, fadeX, fadeY, valid, topInner);
+    innerMiterLanes<Scalar>(x, y, t, r, ntx, nty, nbx, nby, degenerate, i, end,
+                            coreX, coreY, fadeX, fadeY, valid, topInner);
+}
+
+int rasterRow(const RasterTriangle& tri, int y, int x0, int x1,
+              float* r, float* g, float* b, float* a, float* layers) {
+    int start = x0;
+    float py = static_cast<float>(y) + 0.5f;
+
+    // Narrow the row to where each edge can be non-negative, a pixel wider on
+    // both sides than the exact crossing; the lanes still test every centre
+    for (int k = 0; k < 3; k++) {
+        float ea = tri.a[k];
+        if (ea == 0.0f) continue;
+        float cross = -(tri.b[k] * py + tri.c[k]) / ea - 0.5f;
+        if (!(std::fabs(cross) < 1e9f)) continue;
+        if (ea > 0.0f) x0 = std::max(x0, static_cast<int>(std::floor(cross)) - 1);
+        else x1 = std::min(x1, static_cast<int>(std::ceil(cross)) + 2);
+    }
+    if (x0 >= x1) return 0;
+
+    int skip = x0 - start;
+    return rasterRowLanes<Wide>(tri, py, x0, x1, r + skip, g + skip, b + skip, a + skip,
+                                layers ? layers + skip : nullptr);
+}
+
+int rasterLaneWidth() {
+    return Wide::width;
+}
+
+} // namespace batch
+} // namespace ofxVase
@@ -0,0 +1,62 @@
+#pragma once
+/*
+ * ofxVase - SIMD batch kernels
+ *
+ * Structure-of-arrays kernels for the per-vertex and per-segment stages of the
+ * exact tessellator, and the row kernel of the software rasterizer. Each kernel
+ * is written once over a lane type and built for AVX2 (8 lanes) or SSE2
+ * (4 lanes) when the compiler targets them, with a scalar loop for the
+ * remainder and for other architectures.
+ *
+ * Tolerance: the kernels use the same float operations as the scalar reference
+ * in Polyline, so without FMA contraction positions agree to 1e-4 px (only the
+ * parallel-fade fallback normalises differently). With FMA enabled they differ
+ * by under 1e-5 relative, about 0.002 px on a 300 px coordinate.
+ */
+
+#include <cstdint>
+
+namespace ofxVase {
+namespace batch {
+
+// Name of the instruction set the kernels were compiled for ("AVX2", "SSE2" or "scalar")
+const char* instructionSet();
+
+// Polyline::determineTr over n widths, with the fade radius multiplied by feather
+void determineTr(const float* w, float* t, float* r, int n, float scale, float feather);
+
+// Tangent normals of the n-1 segments between consecutive discs (x, y, t + r).
+// degenerate[i] is -1 where the segment is too short for its radius change.
+void segmentTangents(const float* x, const float* y, const float* t, const float* r, int n,
+                     float* ntx, float* nty, float* nbx, float* nby, int32_t* degenerate);
+
+// Inner miter points (core and fade) for the joints 1 .. n-2.
+// valid[i] / topInner[i] are -1 or 0; entries 0 and n-1 are always invalid.
+void innerMiters(const float* x, const float* y, const float* t, const float* r,
+                 const float* ntx, const float* nty, const float* nbx, const float* nby,
+                 const int32_t* degenerate, int n,
+                 float* coreX, float* coreY, float* fadeX, float* fadeY,
+                 int32_t* valid, int32_t* topInner);
+
+// A triangle set up for rasterRow: edge functions a x + b y + c, positive
+// inside, and each color channel as the plane k[0] dx + k[1] dy + k[2] about
+// the origin vertex (dx = x - originX), which keeps thin triangles precise
+struct RasterTriangle {
+    float a[3], b[3], c[3];
+    bool topLeft[3];                 // a zero edge value counts as inside
+    float originX, originY;
+    float red[3], green[3], blue[3], alpha[3];
+    int left, top, right, bottom;    // pixel bounds, right and bottom exclusive
+};
+
+// Blend tri into pixels x0 .. x1-1 of row y (centres at +0.5) of planar float
+// RGBA rows, with the blend function ofEnableAlphaBlending sets, and add one
+// to layers (if not null) where it covers. Returns the pixels covered. The
+// rows start at pixel x0 and are read and rewritten, unchanged, up to
+// rasterLaneWidth() - 1 floats past x1.
+int rasterRow(const RasterTriangle& tri, int y, int x0, int x1,
+              float* r, float* g, float* b, float* a, float* layers);
+int rasterLaneWidth();
+
+} // namespace batch
+} // namespace ofxVase
@@ -0,0 +1,435 @@
+#include "ofxVaseCapture.h"
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+
+namespace ofxVase {
+
+namespace {
+
+struct LogHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t reserved;
+};
+
+// Options as logged; the memory resource isn't, and the smoothing tolerance
+// is the one in effect, with the quality preset's limits applied
+struct OptionsRecord {
+    uint8_t joint;
+    uint8_t cap;
+    uint8_t capPosition;
+    uint8_t flags;
+    float feathering;
+    float worldToScreenRatio;
+    int32_t smoothing;
+    float smoothingTolerance;
+    float miterLimit;
+    float clipRect[4];
+    float approxAngle;
+    float approxAngleThin;
+    float approxAngleShort;
+    float approxThinWidth;
+    float arcStep;
+    float hairlineWidth;
+};
+
+static_assert(sizeof(LogHeader) == 16, "capture log header layout");
+static_assert(sizeof(OptionsRecord) == 64, "capture log options layout");
+static_assert(sizeof(glm::vec2) == 8 && sizeof(ofFloatColor) == 16,
+              "points and colors are logged as they are in memory");
+
+const char logMagic[4] = { 'V', 'A', 'S', 'C' };
+constexpr uint32_t logVersion = 4;
+
+enum RecordType : uint8_t { recordFrame = 1, recordPolyline = 2, recordDraw = 3 };
+enum OptionFlags : uint8_t { optFeather = 1, optNoFeatherAtCap = 2, optNoFeatherAtCore = 4, optClip = 8,
+                           optHairlineLines = 16, optPixelSnap = 32 };
+enum PolylineFlags : uint8_t { perPointColors = 1, perPointWidths = 2, constantStroke = 4, cacheHit = 8 };
+
+constexpr size_t frameRecordSize = 1 + 8 + 8;
+constexpr size_t polylineRecordSize = 1 + sizeof(OptionsRecord) + 4 + 1;
+constexpr size_t drawRecordSize = 1 + 1 + 4;
+
+OptionsRecord encode(const Options& opt) {
+    OptionsRecord r;
+    r.joint = static_cast<uint8_t>(opt.joint);
+    r.cap = static_cast<uint8_t>(opt.cap);
+    r.capPosition = static_cast<uint8_t>(opt.capPosition);
+    r.flags = (opt.feather ? optFeather : 0) | (opt.noFeatherAtCap ? optNoFeatherAtCap : 0) |
+              (opt.noFeatherAtCore ? optNoFeatherAtCore : 0) | (opt.clip ? optClip : 0) |
+              (opt.hairlineLines ? optHairlineLines : 0) | (opt.pixelSnap ? optPixelSnap : 0);
+    r.feathering = opt.feathering;
+    r.worldToScreenRatio = opt.worldToScreenRatio;
+    r.smoothing = opt.smoothing;
+    r.smoothingTolerance = opt.getSmoothingTolerance();
+    r.miterLimit = opt.miterLimit;
+    r.clipRect[0] = opt.clipRect.x;
+    r.clipRect[1] = opt.clipRect.y;
+    r.clipRect[2] = opt.clipRect.width;
+    r.clipRect[3] = opt.clipRect.height;
+    r.approxAngle = opt.approxAngle;
+    r.approxAngleThin = opt.approxAngleThin;
+    r.approxAngleShort = opt.approxAngleShort;
+    r.approxThinWidth = opt.approxThinWidth;
+    r.arcStep = opt.arcStep;
+    r.hairlineWidth = opt.hairlineWidth;
+    return r;
+}
+
+Options decode(const OptionsRecord& r) {
+    Options opt;
+    opt.joint = static_cast<JointStyle>(r.joint);
+    opt.cap = static_cast<CapStyle>(r.cap);
+    opt.capPosition = static_cast<CapPosition>(r.capPosition);
+    opt.feather = (r.flags & optFeather) != 0;
+    opt.noFeatherAtCap = (r.flags & optNoFeatherAtCap) != 0;
+    opt.noFeatherAtCore = (r.flags & optNoFeatherAtCore) != 0;
+    opt.clip = (r.flags & optClip) != 0;
+    opt.hairlineLines = (r.flags & optHairlineLines) != 0;
+    opt.pixelSnap = (r.flags & optPixelSnap) != 0;
+    opt.feathering = r.feathering;
+    opt.worldToScreenRatio = r.worldToScreenRatio;
+    opt.smoothing = r.smoothing;
+    opt.smoothingTolerance = r.smoothingTolerance;
+    opt.miterLimit = r.miterLimit;
+    opt.clipRect = ofRectangle(r.clipRect[0], r.clipRect[1], r.clipRect[2], r.clipRect[3]);
+    opt.approxAngle = r.approxAngle;
+    opt.approxAngleThin = r.approxAngleThin;
+    opt.approxAngleShort = r.approxAngleShort;
+    opt.approxThinWidth = r.approxThinWidth;
+    opt.arcStep = r.arcStep;
+    opt.hairlineWidth = r.hairlineWidth;
+    return opt;
+}
+
+// Records are assembled per thread and written whole under the lock, so
+// captures from worker threads interleave by record, never inside one
+struct Log {
+    std::mutex mutex;
+    std::ofstream out;
+    std::string filePath;
+    std::chrono::steady_clock::time_point start;
+    uint64_t frame = 0;
+    bool frameWritten = false;
+};
+
+Log& getLog() {
+    static Log log;
+    return log;
+}
+
+thread_local int pauseDepth = 0;
+thread_local std::vector<unsigned char> scratch;
+
+template <class T>
+void put(std::vector<unsigned char>& buffer, const T& value) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&value);
+    buffer.insert(buffer.end(), p, p + sizeof(T));
+}
+
+// Appends scratch to the log, after a frame marker if the frame moved on.
+// Call with the log locked.
+void writeRecord(Log& log) {
+    uint64_t frame = ofGetFrameNum();
+    if (!log.frameWritten || frame != log.frame) {
+        unsigned char marker[frameRecordSize];
+        uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - log.start).count();
+        marker[0] = recordFrame;
+        memcpy(marker + 1, &frame, 8);
+        memcpy(marker + 9, &micros, 8);
+        log.out.write(reinterpret_cast<const char*>(marker), sizeof(marker));
+        log.frame = frame;
+        log.frameWritten = true;
+    }
+    log.out.write(reinterpret_cast<const char*>(scratch.data()), static_cast<std::streamsize>(scratch.size()));
+}
+
+} // namespace
+
+// ============================================================================
+// Capture
+// ============================================================================
+
+namespace capture {
+
+std::atomic<bool> active{ false };
+std::atomic<bool> rebuilds{ false };
+
+Pause::Pause() {
+    pauseDepth++;
+}
+
+Pause::~Pause() {
+    pauseDepth--;
+}
+
+bool paused() {
+    return pauseDepth > 0;
+}
+
+namespace {
+
+void record(const PointView& points, const ColorView& colors, const WidthView& widths,
+            const Options& opt, uint8_t flags) {
+    if (points.size() < 2 || colors.empty() || widths.empty()) return;
+
+    // One value or one per point, as the tessellator reads them
+    uint32_t count = static_cast<uint32_t>(points.size());
+    flags |= (colors.size() > 1 ? perPointColors : 0) | (widths.size() > 1 ? perPointWidths : 0);
+    size_t colorCount = flags & perPointColors ? count : 1;
+    size_t widthCount = flags & perPointWidths ? count : 1;
+
+    scratch.clear();
+    scratch.reserve(polylineRecordSize + count * sizeof(glm::vec2) +
+                    colorCount * sizeof(ofFloatColor) + widthCount * sizeof(float));
+    scratch.push_back(recordPolyline);
+    put(scratch, encode(opt));
+    put(scratch, count);
+    scratch.push_back(flags);
+    for (size_t i = 0; i < count; i++) put(scratch, points[i]);
+    for (size_t i = 0; i < colorCount; i++) put(scratch, colors[std::min(i, colors.size() - 1)]);
+    for (size_t i = 0; i < widthCount; i++) put(scratch, widths[std::min(i, widths.size() - 1)]);
+
+    Log& log = getLog();
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if (log.out.is_open()) writeRecord(log);
+}
+
+} // namespace
+
+void polyline(const PointView& points, const ColorView& colors, const WidthView& widths,
+              const Options& opt, bool cached) {
+    record(points, colors, widths, opt, cached ? cacheHit : 0);
+}
+
+// The constant overload of Polyline::rebuild tessellates differently, so
+// the replay has to call the same one
+void polyline(const PointView& points, const ofFloatColor& color, float width, const Options& opt,
+              bool cached) {
+    record(points, ColorView(&color, 1), WidthView(&width, 1), opt,
+           constantStroke | (cached ? cacheHit : 0));
+}
+
+void rebuild(const PointView& points, const ColorView& colors, const WidthView& widths,
+             const Options& opt) {
+    if (pauseDepth == 0) polyline(points, colors, widths, opt);
+}
+
+void rebuild(const PointView& points, const ofFloatColor& color, float width, const Options& opt) {
+    if (pauseDepth == 0) polyline(points, color, width, opt);
+}
+
+void draw(const VertexArrayHolder& holder) {
+    draw(holder.glmode, holder.vertices.size());
+}
+
+void draw(int glmode, size_t vertices) {
+    scratch.clear();
+    scratch.push_back(recordDraw);
+    scratch.push_back(static_cast<uint8_t>(glmode));
+    put(scratch, static_cast<uint32_t>(vertices));
+
+    Log& log = getLog();
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if (log.out.is_open()) writeRecord(log);
+}
+
+} // namespace capture
+
+bool startCapture(const std::string& path, bool rebuilds) {
+    stopCapture();
+
+    Log& log = getLog();
+    std::lock_guard<std::mutex> lock(log.mutex);
+    log.filePath = ofToDataPath(path);
+    log.out.open(log.filePath, std::ios::binary | std::ios::trunc);
+    LogHeader header = {};
+    memcpy(header.magic, logMagic, sizeof(logMagic));
+    header.version = logVersion;
+    log.out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!log.out) {
+        ofLogError("ofxVase") << "startCapture: cannot write " << log.filePath;
+        log.out.close();
+        return false;
+    }
+    log.start = std::chrono::steady_clock::now();
+    log.frameWritten = false;
+    capture::rebuilds = rebuilds;
+    capture::active = true;
+    return true;
+}
+
+void stopCapture() {
+    capture::active = false;
+    capture::rebuilds = false;
+
+    Log& log = getLog();
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if (!log.out.is_open()) return;
+    log.out.close();
+    if (!log.out) {
+        ofLogError("ofxVase") << "stopCapture: error writing " << log.filePath;
+    }
+}
+
+bool isCapturing() {
+    return capture::active;
+}
+
+// ============================================================================
+// CaptureReplay
+// ============================================================================
+
+bool CaptureReplay::load(const std::string& path) {
+    close();
+
+    std::string filePath = ofToDataPath(path);
+    auto fail = [&](const char* reason) {
+        ofLogError("ofxVase") << "CaptureReplay: " << filePath << ": " << reason;
+        close();
+        return false;
+    };
+
+    if (!file.open(filePath)) return fail("cannot open");
+    if (file.size() < sizeof(LogHeader)) return fail("too short");
+
+    const unsigned char* base = file.data();
+    size_t fileSize = file.size();
+    LogHeader header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, logMagic, sizeof(logMagic)) != 0) return fail("not a capture log");
+    if (header.version != logVersion) return fail("unsupported version");
+
+    // Index the records; a log cut short by a crash keeps its complete records
+    size_t offset = sizeof(LogHeader);
+    while (offset < fileSize) {
+        uint8_t type = base[offset];
+        size_t left = fileSize - offset;
+        if (type == recordFrame) {
+            if (left < frameRecordSize) break;
+            Frame frame;
+            memcpy(&frame.frameNumber, base + offset + 1, 8);
+            frames.push_back(frame);
+            firstRecord.push_back(records.size());
+            offset += frameRecordSize;
+            continue;
+        }
+        if (type != recordPolyline && type != recordDraw) return fail("corrupt record");
+
+        // Records before the first marker belong to an unnumbered frame
+        if (frames.empty()) {
+            frames.emplace_back();
+            firstRecord.push_back(0);
+        }
+        Frame& frame = frames.back();
+
+        if (type == recordDraw) {
+            if (left < drawRecordSize) break;
+            uint32_t count;
+            memcpy(&count, base + offset + 2, 4);
+            frame.draws++;
+            frame.drawnVertices += count;
+            offset += drawRecordSize;
+            continue;
+        }
+
+        if (left < polylineRecordSize) break;
+        Record record;
+        record.offset = offset + 1;
+        memcpy(&record.count, base + record.offset + sizeof(OptionsRecord), 4);
+        record.flags = base[record.offset + sizeof(OptionsRecord) + 4];
+        uint64_t colorCount = record.flags & perPointColors ? record.count : 1;
+        uint64_t widthCount = record.flags & perPointWidths ? record.count : 1;
+        uint64_t size = polylineRecordSize + uint64_t(record.count) * sizeof(glm::vec2) +
+                        colorCount * sizeof(ofFloatColor) + widthCount * sizeof(float);
+        if (size > left) break;
+        offset += size;
+        if (record.flags & cacheHit) {
+            frame.cacheHits++;
+            continue;
+        }
+        records.push_back(record);
+        frame.polylines++;
+        frame.points += record.count;
+    }
+    if (offset < fileSize) {
+        ofLogWarning("ofxVase") << "CaptureReplay: " << filePath << ": truncated, "
+                                << fileSize - offset << " bytes ignored";
+    }
+    firstRecord.push_back(records.size());
+    return true;
+}
+
+void CaptureReplay::close() {
+    file.close();
+    frames.clear();
+    records.clear();
+    firstRecord.clear();
+}
+
+void CaptureReplay::run(int repeat) {
+    const unsigned char* base = file.data();
+    capture::Pause pause;
+    Polyline line;
+    std::vector<ofFloatColor> frameColors;
+    std::vector<size_t> firstColor;
+    for (size_t f = 0; f < frames.size(); f++) {
+        Frame& frame = frames[f];
+        frame.seconds = 0;
+
+        // The log is unaligned, so the colors are copied out before timing;
+        // points and widths are read through strided views, which memcpy
+        frameColors.clear();
+        firstColor.clear();
+        for (size_t i = firstRecord[f]; i < firstRecord[f + 1]; i++) {
+            const Record& record = records[i];
+            size_t colorCount = record.flags & perPointColors ? record.count : 1;
+            const unsigned char* p = base + record.offset + sizeof(OptionsRecord) + 5 +
+                                     record.count * sizeof(glm::vec2);
+            firstColor.push_back(frameColors.size());
+            frameColors.resize(frameColors.size() + colorCount);
+            memcpy(static_cast<void*>(frameColors.data() + firstColor.back()), p,
+                   colorCount * sizeof(ofFloatColor));
+        }
+
+        for (int r = 0; r < std::max(repeat, 1); r++) {
+            size_t vertices = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = firstRecord[f]; i < firstRecord[f + 1]; i++) {
+                const Record& record = records[i];
+                OptionsRecord encoded;
+                memcpy(&encoded, base + record.offset, sizeof(encoded));
+                const unsigned char* p = base + record.offset + sizeof(OptionsRecord) + 5;
+                size_t colorCount = record.flags & perPointColors ? record.count : 1;
+                size_t widthCount = record.flags & perPointWidths ? record.count : 1;
+
+                PointView points(static_cast<const void*>(p), record.count, sizeof(glm::vec2));
+                p += record.count * sizeof(glm::vec2);
+                ColorView colors(frameColors.data() + firstColor[i - firstRecord[f]], colorCount);
+                p += colorCount * sizeof(ofFloatColor);
+                WidthView widths(static_cast<const void*>(p), widthCount, sizeof(float));
+
+                if (record.flags & constantStroke) {
+                    line.rebuild(points, colors[0], widths[0], decode(encoded));
+                } else {
+                    line.rebuild(points, colors, widths, decode(encoded));
+                }
+                vertices += line.holder.getCount();
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (r == 0 || seconds < frame.seconds) frame.seconds = seconds;
+            frame.vertices = vertices;
+        }
+    }
+}
+
+double CaptureReplay::getTotalSeconds() const {
+    double total = 0;
+    for (const Frame& frame : frames) total += frame.seconds;
+    return total;
+}
+
+} // namespace ofxVase
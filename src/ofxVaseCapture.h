@@ -0,0 +1,123 @@
+#pragma once
+/*
+ * ofxVase - Draw-call capture and replay
+ *
+ * While capturing, every call of the global draw functions (draw, drawLine,
+ * drawRect) is appended to a binary log with its input, marked when the
+ * tessellation cache served it, and so is every draw call of a Renderer or
+ * TessellationCache, with a frame marker whenever ofGetFrameNum() moves on.
+ * An instanced draw is one record of all its instances' vertices. Apps that
+ * tessellate Polylines themselves can opt in to logging every Polyline and
+ * Segment rebuild, on any thread, as well. CaptureReplay maps the log and
+ * runs the same tessellation workload again, frame by frame, with timings: a
+ * stutter seen in production becomes a benchmark on a developer machine.
+ * drawPoints, generator and PolylineStream input is not captured.
+ *
+ * Log, version 4, little-endian, records unaligned:
+ *   header    16 bytes: "VASC", version, 8 reserved bytes
+ *   frame     type 1, uint64 frame number, uint64 microseconds since start
+ *   polyline  type 2, 64-byte options, uint32 point count, uint8 flags
+ *             (1: per-point colors, 2: per-point widths, 4: rebuilt with the
+ *             constant color and width overload, 8: drawn from the
+ *             tessellation cache, not tessellated), then vec2 points,
+ *             ofFloatColor colors (one without flag 1), float widths (one
+ *             without flag 2)
+ *   draw      type 3, uint8 GL mode (0 triangles, 1 strip, 2 lines),
+ *             uint32 vertex count
+ */
+
+#include "ofxVase.h"
+#include "ofxVaseMeshFile.h"
+
+namespace ofxVase {
+
+// ============================================================================
+// Capture
+// ============================================================================
+
+// Start logging to path (relative to the data folder), replacing any log in
+// progress. With rebuilds, Polyline and Segment rebuilds are logged too, for
+// apps that tessellate themselves and draw with a Renderer. Returns false and
+// logs if the file can't be created.
+bool startCapture(const std::string& path, bool rebuilds = false);
+void stopCapture();
+bool isCapturing();
+
+namespace capture {
+
+// Hooks for the global draw functions and the Renderer, called only while
+// enabled(), and for Polyline::rebuild, called only while rebuildsEnabled()
+extern std::atomic<bool> active;
+extern std::atomic<bool> rebuilds;
+inline bool enabled() { return active.load(std::memory_order_relaxed); }
+inline bool rebuildsEnabled() { return rebuilds.load(std::memory_order_relaxed); }
+
+// A stroke drawn through the API; cached: the tessellation cache had it
+void polyline(const PointView& points, const ColorView& colors, const WidthView& widths,
+              const Options& opt, bool cached = false);
+void polyline(const PointView& points, const ofFloatColor& color, float width, const Options& opt,
+              bool cached = false);
+void rebuild(const PointView& points, const ColorView& colors, const WidthView& widths,
+             const Options& opt);
+void rebuild(const PointView& points, const ofFloatColor& color, float width, const Options& opt);
+void draw(const VertexArrayHolder& holder);
+void draw(int glmode, size_t vertices);  // e.g. a cached VBO, or all instances of a draw
+
+// Rebuilds on this thread aren't recorded while a Pause exists, so a global
+// draw call recorded whole doesn't also record the rebuild it leads to
+struct Pause {
+    Pause();
+    ~Pause();
+};
+bool paused();
+
+} // namespace capture
+
+// ============================================================================
+// CaptureReplay - Re-runs a captured workload
+// ============================================================================
+
+class CaptureReplay {
+public:
+    struct Frame {
+        uint64_t frameNumber = 0;
+        size_t polylines = 0;       // tessellated, and replayed by run()
+        size_t points = 0;
+        size_t cacheHits = 0;       // polylines the cache drew; not replayed
+        size_t draws = 0;
+        size_t drawnVertices = 0;   // as captured
+        size_t vertices = 0;        // tessellated by the last run()
+        double seconds = 0;         // tessellation time, fastest of the repeats
+    };
+
+    CaptureReplay() = default;
+
+    // Maps path (relative to the data folder). Returns false and logs if the
+    // file is missing, truncated or of another format or version.
+    bool load(const std::string& path);
+    void close();
+
+    size_t getFrameCount() const { return frames.size(); }
+    const Frame& getFrame(size_t i) const { return frames[i]; }
+    const std::vector<Frame>& getFrames() const { return frames; }
+
+    // Tessellate every frame's polylines repeat times, rebuilding one Polyline
+    // as an app reusing its objects would, and fill in vertices and seconds.
+    // Cache hits cost the app no tessellation, so they are skipped.
+    void run(int repeat = 1);
+    double getTotalSeconds() const;
+
+private:
+    struct Record {
+        size_t offset;      // of the options block
+        uint32_t count;
+        uint8_t flags;
+    };
+
+    MappedFile file;
+    std::vector<Frame> frames;
+    std::vector<Record> records;
+    std::vector<size_t> firstRecord;   // per frame, into records; one extra at the end
+};
+
+} // namespace ofxVase
@@ -0,0 +1,349 @@
+#include "ofxVaseMeshFile.h"
+
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ofxVase {
+
+namespace {
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t strokeCount;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t strokesOffset;
+    uint64_t positionsOffset;
+    uint64_t colorsOffset;
+    uint64_t indicesOffset;
+};
+
+static_assert(sizeof(FileHeader) == 64, "mesh file header layout");
+static_assert(sizeof(MeshFile::Stroke) == 48, "mesh file stroke layout");
+static_assert(sizeof(glm::vec2) == 8 && sizeof(ofFloatColor) == 16,
+              "positions and colors are read from the file in place");
+
+const char fileMagic[4] = { 'V', 'A', 'S', 'M' };
+constexpr uint32_t flagIndexed = 1;
+
+size_t align16(size_t offset) {
+    return (offset + 15) & ~size_t(15);
+}
+
+// True if count elements of size bytes at offset lie inside a file of fileSize bytes
+bool sectionFits(uint64_t offset, uint64_t count, size_t size, size_t fileSize) {
+    if (offset % 16 != 0 || offset > fileSize) return false;
+    return count <= (fileSize - offset) / size;
+}
+
+} // namespace
+
+// ============================================================================
+// MappedFile
+// ============================================================================
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filePath) {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    fileHandle = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        close();
+        return false;
+    }
+    mapHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    mapping = mapHandle ? MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!mapping) {
+        close();
+        return false;
+    }
+    mappingSize = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    mapping = p;
+    mappingSize = static_cast<size_t>(st.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (mapping) UnmapViewOfFile(mapping);
+    if (mapHandle) CloseHandle(mapHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mapHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (mapping) munmap(mapping, mappingSize);
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+}
+
+// ============================================================================
+// MeshFile
+// ============================================================================
+
+MeshFile::~MeshFile() {
+    close();
+}
+
+bool MeshFile::load(const std::string& path) {
+    close();
+    strokes.clear();
+    vertexCount = 0;
+    indexCount = 0;
+    uploaded = false;
+
+    std::string filePath = ofToDataPath(path);
+    auto fail = [&](const char* reason) {
+        ofLogError("ofxVase") << "MeshFile: " << filePath << ": " << reason;
+        close();
+        return false;
+    };
+
+    if (!file.open(filePath)) return fail("cannot open");
+    if (file.size() < sizeof(FileHeader)) return fail("too short");
+    size_t fileSize = file.size();
+
+    const unsigned char* base = file.data();
+    FileHeader header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0) return fail("not a mesh file");
+    if (header.version != version) return fail("unsupported version");
+    if (((header.flags & flagIndexed) != 0) != (header.indexCount > 0)) return fail("corrupt header");
+
+    if (!sectionFits(header.strokesOffset, header.strokeCount, sizeof(Stroke), fileSize) ||
+        !sectionFits(header.positionsOffset, header.vertexCount, sizeof(glm::vec2), fileSize) ||
+        !sectionFits(header.colorsOffset, header.vertexCount, sizeof(ofFloatColor), fileSize) ||
+        !sectionFits(header.indicesOffset, header.indexCount, sizeof(uint32_t), fileSize)) {
+        return fail("truncated");
+    }
+
+    // The stroke table is small and outlives the mapping
+    strokes.resize(header.strokeCount);
+    memcpy(strokes.data(), base + header.strokesOffset, strokes.size() * sizeof(Stroke));
+    for (const Stroke& s : strokes) {
+        if (s.firstVertex > header.vertexCount || s.vertexCount > header.vertexCount - s.firstVertex ||
+            s.firstIndex > header.indexCount || s.indexCount > header.indexCount - s.firstIndex) {
+            strokes.clear();
+            return fail("stroke out of range");
+        }
+    }
+
+    vertexCount = header.vertexCount;
+    indexCount = header.indexCount;
+    positions = reinterpret_cast<const glm::vec2*>(base + header.positionsOffset);
+    colors = reinterpret_cast<const ofFloatColor*>(base + header.colorsOffset);
+    indices = indexCount ? reinterpret_cast<const uint32_t*>(base + header.indicesOffset) : nullptr;
+    return true;
+}
+
+void MeshFile::close() {
+    positions = nullptr;
+    colors = nullptr;
+    indices = nullptr;
+    file.close();
+}
+
+bool MeshFile::upload() {
+    if (!positions) {
+        ofLogWarning("ofxVase") << "MeshFile::upload: no file loaded";
+        return false;
+    }
+    // Indices are absolute, so narrowing them would wrap
+    if (indexCount && sizeof(ofIndexType) < sizeof(uint32_t) &&
+        vertexCount > std::numeric_limits<ofIndexType>::max() + size_t(1)) {
+        ofLogError("ofxVase") << "MeshFile::upload: " << vertexCount
+                              << " indexed vertices don't fit 16-bit indices";
+        return false;
+    }
+    int count = static_cast<int>(vertexCount);
+    vbo.setVertexData(&positions[0].x, 2, count, GL_STATIC_DRAW, sizeof(glm::vec2));
+    vbo.setColorData(colors, count, GL_STATIC_DRAW);
+    if (indexCount) {
+        if (sizeof(ofIndexType) == sizeof(uint32_t)) {
+            vbo.setIndexData(reinterpret_cast<const ofIndexType*>(indices),
+                             static_cast<int>(indexCount), GL_STATIC_DRAW);
+        } else {
+            // 16-bit indices (OpenGL ES) need a narrowed copy
+            std::vector<ofIndexType> narrow(indices, indices + indexCount);
+            vbo.setIndexData(narrow.data(), static_cast<int>(indexCount), GL_STATIC_DRAW);
+        }
+    }
+    uploaded = true;
+    return true;
+}
+
+void MeshFile::draw() const {
+    if (!uploaded) return;
+    if (indexCount) {
+        vbo.drawElements(GL_TRIANGLES, static_cast<int>(indexCount));
+    } else {
+        vbo.draw(GL_TRIANGLES, 0, static_cast<int>(vertexCount));
+    }
+}
+
+void MeshFile::draw(size_t stroke) const {
+    if (!uploaded) return;
+    const Stroke& s = strokes[stroke];
+    if (indexCount) {
+        vbo.drawElements(GL_TRIANGLES, static_cast<int>(s.indexCount), static_cast<int>(s.firstIndex));
+    } else {
+        vbo.draw(GL_TRIANGLES, static_cast<int>(s.firstVertex), static_cast<int>(s.vertexCount));
+    }
+}
+
+// ============================================================================
+// MeshFileWriter
+// ============================================================================
+
+namespace {
+
+struct VertexKey {
+    glm::vec2 pos;
+    ofFloatColor color;
+
+    bool operator==(const VertexKey& o) const { return memcmp(this, &o, sizeof(*this)) == 0; }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& k) const {
+        uint32_t w[6];
+        memcpy(w, &k, sizeof(w));
+        uint64_t h = 0x9E3779B97F4A7C15ull;
+        for (uint32_t v : w) {
+            h = (h ^ v) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 29;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+} // namespace
+
+MeshFileWriter::MeshFileWriter(bool indexed)
+    : indexed(indexed) {}
+
+void MeshFileWriter::clear() {
+    strokes.clear();
+    positions.clear();
+    colors.clear();
+    indices.clear();
+}
+
+size_t MeshFileWriter::add(const VertexArrayHolder& holder) {
+    if (holder.glmode != VertexArrayHolder::DRAW_TRIANGLES) {
+        VertexArrayHolder triangles;
+        triangles.push(holder);
+        return add(triangles);
+    }
+
+    MeshFile::Stroke s = {};
+    s.firstVertex = positions.size();
+    s.firstIndex = indices.size();
+    size_t n = holder.vertices.size();
+    if (n) {
+        s.left = s.right = holder.vertices[0].x;
+        s.top = s.bottom = holder.vertices[0].y;
+    }
+    for (const glm::vec3& v : holder.vertices) {
+        s.left = std::min(s.left, v.x);
+        s.right = std::max(s.right, v.x);
+        s.top = std::min(s.top, v.y);
+        s.bottom = std::max(s.bottom, v.y);
+    }
+
+    if (!indexed) {
+        for (size_t i = 0; i < n; i++) {
+            positions.push_back(glm::vec2(holder.vertices[i]));
+            colors.push_back(holder.colors[i]);
+        }
+    } else {
+        std::unordered_map<VertexKey, uint32_t, VertexKeyHash> seen;
+        seen.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            VertexKey key = { glm::vec2(holder.vertices[i]), holder.colors[i] };
+            auto found = seen.emplace(key, static_cast<uint32_t>(positions.size()));
+            if (found.second) {
+                positions.push_back(key.pos);
+                colors.push_back(key.color);
+            }
+            indices.push_back(found.first->second);
+        }
+        s.indexCount = n;
+    }
+    s.vertexCount = positions.size() - s.firstVertex;
+
+    strokes.push_back(s);
+    return strokes.size() - 1;
+}
+
+bool MeshFileWriter::save(const std::string& path) const {
+    FileHeader header = {};
+    memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.version = MeshFile::version;
+    header.flags = indices.empty() ? 0 : flagIndexed;
+    header.strokeCount = static_cast<uint32_t>(strokes.size());
+    header.vertexCount = positions.size();
+    header.indexCount = indices.size();
+    header.strokesOffset = align16(sizeof(FileHeader));
+    header.positionsOffset = align16(header.strokesOffset + strokes.size() * sizeof(MeshFile::Stroke));
+    header.colorsOffset = align16(header.positionsOffset + positions.size() * sizeof(glm::vec2));
+    header.indicesOffset = align16(header.colorsOffset + colors.size() * sizeof(ofFloatColor));
+
+    std::string filePath = ofToDataPath(path);
+    std::ofstream out(filePath, std::ios::binary | std::ios::trunc);
+    size_t written = 0;
+    auto write = [&](uint64_t offset, const void* data, size_t size) {
+        static const char zeros[16] = {};
+        out.write(zeros, static_cast<std::streamsize>(offset - written));
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        written = offset + size;
+    };
+    write(0, &header, sizeof(header));
+    write(header.strokesOffset, strokes.data(), strokes.size() * sizeof(MeshFile::Stroke));
+    write(header.positionsOffset, positions.data(), positions.size() * sizeof(glm::vec2));
+    write(header.colorsOffset, colors.data(), colors.size() * sizeof(ofFloatColor));
+    write(header.indicesOffset, indices.data(), indices.size() * sizeof(uint32_t));
+    out.close();
+
+    if (!out) {
+        ofLogError("ofxVase") << "MeshFileWriter: cannot write " << filePath;
+        return false;
+    }
+    return true;
+}
+
+} // namespace ofxVase
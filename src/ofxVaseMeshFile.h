@@ -0,0 +1,150 @@
+#pragma once
+/*
+ * ofxVase - Binary mesh files
+ *
+ * Tessellated strokes saved once and loaded by memory-mapping the file, so
+ * static geometry (borders, roads, glyph outlines) skips tessellation at
+ * startup. The loader hands the mapped arrays straight to the GPU; nothing is
+ * parsed or copied per vertex.
+ *
+ * Layout, version 1, little-endian, sections 16-byte aligned:
+ *   header     64 bytes: "VASM", version, flags, stroke count, vertex count,
+ *              index count, then the byte offsets of the four sections
+ *   strokes    MeshFile::Stroke per stroke: vertex and index ranges, bounds
+ *   positions  vec2 per vertex
+ *   colors     ofFloatColor per vertex
+ *   indices    uint32 per index, absolute into the vertex arrays (flag bit 0)
+ * Every stroke is a triangle list.
+ */
+
+#include "ofxVase.h"
+#include <cstdint>
+
+namespace ofxVase {
+
+// ============================================================================
+// MappedFile - Read-only mapping of a whole file
+// ============================================================================
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // filePath is used as given, not relative to the data folder
+    bool open(const std::string& filePath);
+    void close();
+
+    bool isOpen() const { return mapping != nullptr; }
+    const unsigned char* data() const { return static_cast<const unsigned char*>(mapping); }
+    size_t size() const { return mappingSize; }
+
+private:
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mapHandle = nullptr;
+#endif
+};
+
+// ============================================================================
+// MeshFile - Memory-mapped reader
+// ============================================================================
+
+class MeshFile {
+public:
+    static constexpr uint32_t version = 1;
+
+    struct Stroke {
+        uint64_t firstVertex;
+        uint64_t vertexCount;
+        uint64_t firstIndex;   // 0 / 0 when the file isn't indexed
+        uint64_t indexCount;
+        float left, top, right, bottom;
+
+        ofRectangle getBounds() const { return ofRectangle(left, top, right - left, bottom - top); }
+    };
+
+    MeshFile() = default;
+    ~MeshFile();
+
+    MeshFile(const MeshFile&) = delete;
+    MeshFile& operator=(const MeshFile&) = delete;
+
+    // Maps path (relative to the data folder). Returns false and logs if the
+    // file is missing, truncated, or of another format or version.
+    bool load(const std::string& path);
+
+    // Unmaps the file. Stroke records and uploaded geometry stay available.
+    void close();
+    bool isMapped() const { return file.isOpen(); }
+
+    size_t getStrokeCount() const { return strokes.size(); }
+    const Stroke& getStroke(size_t i) const { return strokes[i]; }
+
+    // Views into the mapping; null after close()
+    size_t getVertexCount() const { return vertexCount; }
+    size_t getIndexCount() const { return indexCount; }
+    const glm::vec2* getPositions() const { return positions; }
+    const ofFloatColor* getColors() const { return colors; }
+    const uint32_t* getIndices() const { return indices; }
+    bool isIndexed() const { return indexCount > 0; }
+
+    // Upload all strokes into one static VBO, read directly from the mapping.
+    // The file can be closed afterwards. Returns false and logs if nothing is
+    // loaded, or if the file is indexed past 65535 and ofIndexType is 16-bit
+    // (OpenGL ES): save such files unindexed.
+    bool upload();
+
+    // Draw every stroke, or one, from the uploaded VBO
+    void draw() const;
+    void draw(size_t stroke) const;
+
+private:
+    MappedFile file;
+
+    std::vector<Stroke> strokes;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    const glm::vec2* positions = nullptr;
+    const ofFloatColor* colors = nullptr;
+    const uint32_t* indices = nullptr;
+
+    ofVbo vbo;
+    bool uploaded = false;
+};
+
+// ============================================================================
+// MeshFileWriter - Collects strokes and saves them
+// ============================================================================
+
+class MeshFileWriter {
+public:
+    // indexed: merge identical vertices of a stroke and write an index array,
+    // which makes files of feathered strokes less than half the size
+    explicit MeshFileWriter(bool indexed = false);
+
+    // Returns the stroke's number in the file
+    size_t add(const VertexArrayHolder& holder);
+    size_t add(const Polyline& polyline) { return add(polyline.holder); }
+    size_t add(const Segment& segment) { return add(segment.holder); }
+
+    // Writes path (relative to the data folder); returns false and logs on failure
+    bool save(const std::string& path) const;
+
+    void clear();
+    size_t getStrokeCount() const { return strokes.size(); }
+
+private:
+    bool indexed;
+    std::vector<MeshFile::Stroke> strokes;
+    std::vector<glm::vec2> positions;
+    std::vector<ofFloatColor> colors;
+    std::vector<uint32_t> indices;
+};
+
+} // namespace ofxVase
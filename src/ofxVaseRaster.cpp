@@ -0,0 +1,349 @@
+#include "ofxVaseRaster.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace ofxVase {
+
+namespace {
+
+// Tile buffer row length: the row kernel may run a lane group past the tile edge
+constexpr int tileStride = Rasterizer::tileSize + 8;
+
+} // namespace
+
+// ============================================================================
+// Rasterizer
+// ============================================================================
+
+Rasterizer::Rasterizer(int width, int height) {
+    allocate(width, height);
+}
+
+void Rasterizer::allocate(int w, int h) {
+    width = std::max(0, w);
+    height = std::max(0, h);
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+    bins.assign(static_cast<size_t>(tilesX) * tilesY, std::vector<uint32_t>());
+    triangles.clear();
+    clear();
+}
+
+void Rasterizer::clear(const ofFloatColor& color) {
+    size_t n = static_cast<size_t>(width) * height;
+    planes[0].assign(n, color.r);
+    planes[1].assign(n, color.g);
+    planes[2].assign(n, color.b);
+    planes[3].assign(n, color.a);
+    if (!layers.empty()) layers.assign(n, 0.0f);
+    triangles.clear();
+    triangleStrokes.clear();
+    fragments.clear();
+}
+
+void Rasterizer::setLayerCounting(bool enabled) {
+    if (!enabled) {
+        layers = std::vector<float>();
+    } else if (layers.empty()) {
+        layers.assign(static_cast<size_t>(width) * height, 0.0f);
+    }
+}
+
+size_t Rasterizer::draw(const VertexArrayHolder& holder) {
+    if (holder.glmode == VertexArrayHolder::DRAW_LINES) {
+        VertexArrayHolder triangles;
+        triangles.push(holder);
+        return draw(triangles);
+    }
+    fragments.push_back(0);
+    const auto& v = holder.vertices;
+    const auto& c = holder.colors;
+    size_t n = v.size();
+    if (holder.glmode == VertexArrayHolder::DRAW_TRIANGLES) {
+        for (size_t i = 0; i + 2 < n; i += 3) {
+            setup(v[i], v[i + 1], v[i + 2], c[i], c[i + 1], c[i + 2]);
+        }
+    } else {
+        // Winding doesn't matter here, so strip triangles keep their vertex order
+        for (size_t i = 0; i + 2 < n; i++) {
+            setup(v[i], v[i + 1], v[i + 2], c[i], c[i + 1], c[i + 2]);
+        }
+    }
+    triangleStrokes.resize(triangles.size(), static_cast<uint32_t>(fragments.size() - 1));
+    return fragments.size() - 1;
+}
+
+void Rasterizer::setup(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2,
+                       const ofFloatColor& c0, const ofFloatColor& c1, const ofFloatColor& c2) {
+    glm::vec2 p[3] = { glm::vec2(p0), glm::vec2(p1), glm::vec2(p2) };
+    const ofFloatColor* col[3] = { &c0, &c1, &c2 };
+
+    float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+    if (area == 0.0f || !std::isfinite(area)) return;
+    if (area < 0.0f) {
+        std::swap(p[1], p[2]);
+        std::swap(col[1], col[2]);
+        area = -area;
+    }
+
+    float left = std::min({ p[0].x, p[1].x, p[2].x });
+    float right = std::max({ p[0].x, p[1].x, p[2].x });
+    float top = std::min({ p[0].y, p[1].y, p[2].y });
+    float bottom = std::max({ p[0].y, p[1].y, p[2].y });
+
+    // Clamped before converting, so far off-canvas coordinates stay in int range
+    auto pixel = [](float v, int size) {
+        return static_cast<int>(std::min(std::max(v, 0.0f), static_cast<float>(size)));
+    };
+    batch::RasterTriangle t;
+    t.left = pixel(std::floor(left), width);
+    t.top = pixel(std::floor(top), height);
+    t.right = pixel(std::ceil(right), width);
+    t.bottom = pixel(std::ceil(bottom), height);
+    if (t.left >= t.right || t.top >= t.bottom) return;
+
+    // Edge k is opposite vertex k. The reversed edge of a neighbour gets exactly
+    // negated coefficients, which keeps the fill rule watertight.
+    for (int k = 0; k < 3; k++) {
+        const glm::vec2& from = p[(k + 1) % 3];
+        const glm::vec2& to = p[(k + 2) % 3];
+        t.a[k] = from.y - to.y;
+        t.b[k] = to.x - from.x;
+        t.c[k] = from.x * to.y - to.x * from.y;
+        t.topLeft[k] = t.a[k] > 0.0f || (t.a[k] == 0.0f && t.b[k] > 0.0f);
+    }
+
+    // Barycentric weight k is edge k / area, so each channel's gradient is
+    // sum(a_k, b_k * color_k) / area; differences to vertex 0 avoid cancellation
+    t.originX = p[0].x;
+    t.originY = p[0].y;
+    auto plane = [&](float* out, int channel) {
+        float base = (*col[0])[channel];
+        out[0] = out[1] = 0.0f;
+        for (int k = 1; k < 3; k++) {
+            float v = ((*col[k])[channel] - base) / area;
+            out[0] += t.a[k] * v;
+            out[1] += t.b[k] * v;
+        }
+        out[2] = base;
+    };
+    plane(t.red, 0);
+    plane(t.green, 1);
+    plane(t.blue, 2);
+    plane(t.alpha, 3);
+
+    triangles.push_back(t);
+}
+
+void Rasterizer::finish() {
+    if (triangles.empty()) return;
+
+    for (auto& bin : bins) bin.clear();
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const batch::RasterTriangle& t = triangles[i];
+        for (int ty = t.top / tileSize; ty <= (t.bottom - 1) / tileSize; ty++) {
+            for (int tx = t.left / tileSize; tx <= (t.right - 1) / tileSize; tx++) {
+                bins[ty * tilesX + tx].push_back(static_cast<uint32_t>(i));
+            }
+        }
+    }
+
+    int tileCount = tilesX * tilesY;
+    int threads = threadCount > 0 ? threadCount
+                                  : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threads = std::min(threads, tileCount);
+
+    // Tiles are handed out one at a time; busy tiles cost far more than empty ones.
+    // Each worker counts fragments per stroke on its own, summed afterwards.
+    std::atomic<int> next(0);
+    std::vector<std::vector<uint64_t>> counts(std::max(threads, 1));
+    auto work = [&](int worker) {
+        std::vector<float> buffer(5 * tileStride * tileSize);
+        counts[worker].assign(fragments.size(), 0);
+        for (int tile = next++; tile < tileCount; tile = next++) {
+            rasterizeTile(tile, buffer.data(), counts[worker]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++) pool.emplace_back(work, i);
+    work(0);
+    for (auto& thread : pool) thread.join();
+
+    for (const auto& count : counts) {
+        for (size_t s = 0; s < count.size(); s++) fragments[s] += count[s];
+    }
+    triangles.clear();
+    triangleStrokes.clear();
+}
+
+void Rasterizer::rasterizeTile(int tile, float* buffer, std::vector<uint64_t>& strokeFragments) {
+    const std::vector<uint32_t>& bin = bins[tile];
+    if (bin.empty()) return;
+
+    int tx0 = (tile % tilesX) * tileSize;
+    int ty0 = (tile / tilesX) * tileSize;
+    int tx1 = std::min(tx0 + tileSize, width);
+    int ty1 = std::min(ty0 + tileSize, height);
+    size_t plane = static_cast<size_t>(tileStride) * tileSize;
+    bool counting = !layers.empty();
+    int channels = counting ? 5 : 4;
+    auto canvas = [&](int c) { return c < 4 ? planes[c].data() : layers.data(); };
+
+    // Blend in a private copy of the tile, which stays in cache and lets the
+    // kernel overrun the tile edge without touching a neighbour's pixels
+    for (int y = ty0; y < ty1; y++) {
+        size_t row = static_cast<size_t>(y) * width;
+        for (int c = 0; c < channels; c++) {
+            std::copy(canvas(c) + row + tx0, canvas(c) + row + tx1,
+                      buffer + c * plane + (y - ty0) * tileStride);
+        }
+    }
+
+    for (uint32_t index : bin) {
+        const batch::RasterTriangle& t = triangles[index];
+        int x0 = std::max(t.left, tx0);
+        int x1 = std::min(t.right, tx1);
+        int y0 = std::max(t.top, ty0);
+        int y1 = std::min(t.bottom, ty1);
+        uint64_t covered = 0;
+        for (int y = y0; y < y1; y++) {
+            float* row = buffer + (y - ty0) * tileStride + (x0 - tx0);
+            covered += batch::rasterRow(t, y, x0, x1, row, row + plane, row + 2 * plane,
+                                        row + 3 * plane, counting ? row + 4 * plane : nullptr);
+        }
+        strokeFragments[triangleStrokes[index]] += covered;
+    }
+
+    for (int y = ty0; y < ty1; y++) {
+        size_t row = static_cast<size_t>(y) * width;
+        for (int c = 0; c < channels; c++) {
+            const float* src = buffer + c * plane + (y - ty0) * tileStride;
+            std::copy(src, src + (tx1 - tx0), canvas(c) + row + tx0);
+        }
+    }
+}
+
+void Rasterizer::getPixels(ofPixels& pixels) {
+    finish();
+    pixels.allocate(width, height, OF_PIXELS_RGBA);
+    unsigned char* out = pixels.getData();
+    size_t n = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < n; i++) {
+        for (int c = 0; c < 4; c++) {
+            float v = std::min(std::max(planes[c][i], 0.0f), 1.0f);
+            out[i * 4 + c] = static_cast<unsigned char>(v * 255.0f + 0.5f);
+        }
+    }
+}
+
+void Rasterizer::getPixels(ofFloatPixels& pixels) {
+    finish();
+    pixels.allocate(width, height, OF_PIXELS_RGBA);
+    float* out = pixels.getData();
+    size_t n = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < n; i++) {
+        for (int c = 0; c < 4; c++) out[i * 4 + c] = planes[c][i];
+    }
+}
+
+bool Rasterizer::save(const std::string& path) {
+    ofPixels pixels;
+    getPixels(pixels);
+    if (!ofSaveImage(pixels, path)) {
+        ofLogError("ofxVase") << "Rasterizer: cannot write " << ofToDataPath(path);
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// OverdrawAnalyzer
+// ============================================================================
+
+OverdrawAnalyzer::OverdrawAnalyzer(int width, int height) {
+    allocate(width, height);
+}
+
+void OverdrawAnalyzer::allocate(int width, int height) {
+    raster.allocate(width, height);
+    raster.setLayerCounting(true);
+}
+
+void OverdrawAnalyzer::clear() {
+    raster.clear();
+}
+
+const float* OverdrawAnalyzer::getLayers() {
+    raster.finish();
+    return raster.getLayers();
+}
+
+uint64_t OverdrawAnalyzer::getFragmentCount(size_t stroke) {
+    raster.finish();
+    return raster.getFragmentCount(stroke);
+}
+
+OverdrawAnalyzer::Stats OverdrawAnalyzer::getStats() {
+    Stats stats;
+    const float* layers = getLayers();
+    size_t n = static_cast<size_t>(raster.getWidth()) * raster.getHeight();
+    for (size_t i = 0; i < n; i++) {
+        int count = static_cast<int>(layers[i]);
+        if (count == 0) continue;
+        stats.coveredPixels++;
+        stats.fragments += count;
+        stats.maxLayers = std::max(stats.maxLayers, count);
+    }
+    if (stats.coveredPixels) {
+        stats.meanOverdraw = static_cast<double>(stats.fragments) / stats.coveredPixels;
+    }
+    return stats;
+}
+
+void OverdrawAnalyzer::getHeatMap(ofPixels& pixels, int scaleLayers) {
+    static const ofFloatColor ramp[] = {
+        { 0, 0, 1 }, { 0, 1, 1 }, { 0, 1, 0 }, { 1, 1, 0 }, { 1, 0, 0 }, { 1, 1, 1 }
+    };
+    constexpr int stops = sizeof(ramp) / sizeof(ramp[0]);
+
+    if (scaleLayers <= 0) scaleLayers = std::max(getStats().maxLayers, 1);
+    const float* layers = getLayers();
+    int width = raster.getWidth();
+    int height = raster.getHeight();
+    pixels.allocate(width, height, OF_PIXELS_RGBA);
+    unsigned char* out = pixels.getData();
+
+    size_t n = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < n; i++) {
+        ofFloatColor c(0, 0, 0, 1);
+        if (layers[i] > 0) {
+            // One layer maps to the first stop, scaleLayers and above to the last
+            float t = scaleLayers > 1 ? (layers[i] - 1) / (scaleLayers - 1) : 1.0f;
+            float f = std::min(std::max(t, 0.0f), 1.0f) * (stops - 1);
+            int k = std::min(static_cast<int>(f), stops - 2);
+            float u = f - k;
+            c.r = ramp[k].r + (ramp[k + 1].r - ramp[k].r) * u;
+            c.g = ramp[k].g + (ramp[k + 1].g - ramp[k].g) * u;
+            c.b = ramp[k].b + (ramp[k + 1].b - ramp[k].b) * u;
+        }
+        out[i * 4 + 0] = static_cast<unsigned char>(c.r * 255.0f + 0.5f);
+        out[i * 4 + 1] = static_cast<unsigned char>(c.g * 255.0f + 0.5f);
+        out[i * 4 + 2] = static_cast<unsigned char>(c.b * 255.0f + 0.5f);
+        out[i * 4 + 3] = 255;
+    }
+}
+
+bool OverdrawAnalyzer::saveHeatMap(const std::string& path, int scaleLayers) {
+    ofPixels pixels;
+    getHeatMap(pixels, scaleLayers);
+    if (!ofSaveImage(pixels, path)) {
+        ofLogError("ofxVase") << "OverdrawAnalyzer: cannot write " << ofToDataPath(path);
+        return false;
+    }
+    return true;
+}
+
+} // namespace ofxVase
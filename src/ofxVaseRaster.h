@@ -0,0 +1,137 @@
+#pragma once
+/*
+ * ofxVase - Software rasterizer
+ *
+ * Draws tessellated strokes on the CPU, for headless rendering, thumbnails and
+ * golden-image tests on machines without a GL context. Triangles are rasterized
+ * with the GL conventions the Renderer relies on: pixel centres at +0.5, a
+ * top-left fill rule, linear per-vertex color and ofEnableAlphaBlending's
+ * blend function. Coordinates are screen pixels, y down, as in the default
+ * openFrameworks view.
+ *
+ * draw() only sets triangles up; finish() bins them into 64 px tiles and
+ * rasterizes the tiles in parallel. Each tile blends its triangles in draw
+ * order, so the result doesn't depend on the thread count.
+ *
+ * OverdrawAnalyzer counts the layers blended into every pixel, to measure
+ * the fill cost of overlapping discs, joints and fade strips.
+ */
+
+#include "ofxVase.h"
+#include "ofxVaseBatch.h"
+
+namespace ofxVase {
+
+// ============================================================================
+// Rasterizer - Tiled CPU canvas
+// ============================================================================
+
+class Rasterizer {
+public:
+    static constexpr int tileSize = 64;
+
+    Rasterizer() = default;
+    Rasterizer(int width, int height);
+
+    // Resizes the canvas and clears it to transparent black
+    void allocate(int width, int height);
+    // Also resets the layer counts and the strokes' fragment counts
+    void clear(const ofFloatColor& color = ofFloatColor(0, 0, 0, 0));
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Worker threads for finish(); 0 uses one per hardware thread
+    void setThreadCount(int threads) { threadCount = threads; }
+
+    // Queue the triangles of a tessellated stroke. Returns the stroke's number
+    // since the last clear(), for getFragmentCount().
+    size_t draw(const VertexArrayHolder& holder);
+    size_t draw(const Polyline& polyline) { return draw(polyline.holder); }
+    size_t draw(const Segment& segment) { return draw(segment.holder); }
+
+    // Rasterize everything queued since the last finish()
+    void finish();
+    size_t getQueuedTriangleCount() const { return triangles.size(); }
+
+    // Read back, finishing first. 8-bit pixels are rounded from the float canvas.
+    void getPixels(ofPixels& pixels);
+    void getPixels(ofFloatPixels& pixels);
+
+    // Writes an 8-bit RGBA image (path relative to the data folder); the
+    // format follows the extension, so use .png to keep alpha
+    bool save(const std::string& path);
+
+    // Planar float channels of the canvas, width * height each, rows top down
+    const float* getChannel(int channel) const { return planes[channel].data(); }
+
+    // Count the triangles covering each pixel (off by default; costs a plane
+    // more per tile). getLayers() is null while off, and valid after finish().
+    void setLayerCounting(bool enabled);
+    const float* getLayers() const { return layers.empty() ? nullptr : layers.data(); }
+
+    // Pixels shaded for a stroke, overdraw included, once it's finished
+    size_t getStrokeCount() const { return fragments.size(); }
+    uint64_t getFragmentCount(size_t stroke) const { return fragments[stroke]; }
+
+private:
+    void setup(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2,
+               const ofFloatColor& c0, const ofFloatColor& c1, const ofFloatColor& c2);
+    void rasterizeTile(int tile, float* buffer, std::vector<uint64_t>& strokeFragments);
+
+    int width = 0;
+    int height = 0;
+    int threadCount = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+
+    std::vector<float> planes[4];
+    std::vector<float> layers;
+    std::vector<batch::RasterTriangle> triangles;
+    std::vector<uint32_t> triangleStrokes;
+    std::vector<uint64_t> fragments;
+    std::vector<std::vector<uint32_t>> bins;
+};
+
+// ============================================================================
+// OverdrawAnalyzer - Depth complexity of tessellated output
+// ============================================================================
+
+class OverdrawAnalyzer {
+public:
+    struct Stats {
+        uint64_t fragments = 0;       // pixels shaded, summed over all strokes
+        uint64_t coveredPixels = 0;   // pixels with at least one layer
+        int maxLayers = 0;
+        double meanOverdraw = 0;      // fragments / coveredPixels
+    };
+
+    OverdrawAnalyzer() = default;
+    OverdrawAnalyzer(int width, int height);
+
+    void allocate(int width, int height);
+    void clear();
+    void setThreadCount(int threads) { raster.setThreadCount(threads); }
+
+    // Returns the stroke's number, for getFragmentCount()
+    size_t add(const VertexArrayHolder& holder) { return raster.draw(holder); }
+    size_t add(const Polyline& polyline) { return raster.draw(polyline); }
+    size_t add(const Segment& segment) { return raster.draw(segment); }
+
+    Stats getStats();
+    size_t getStrokeCount() const { return raster.getStrokeCount(); }
+    uint64_t getFragmentCount(size_t stroke);
+
+    // Layers per pixel, width * height, rows top down
+    const float* getLayers();
+
+    // Heat map, opaque: black where nothing is drawn, then blue through green,
+    // yellow and red to white at scaleLayers (0: the maximum found)
+    void getHeatMap(ofPixels& pixels, int scaleLayers = 0);
+    bool saveHeatMap(const std::string& path, int scaleLayers = 0);
+
+private:
+    Rasterizer raster;
+};
+
+} // namespace ofxVase
@@ -0,0 +1,99 @@
+/*
+ * vase-tests - Headless checks of ofxVase output
+ *
+ * Tessellates fixed strokes and compares them, rasterized with the software
+ * Rasterizer, with analytic coverage or with another code path that has to
+ * agree, within the tolerance the feature documents; files are checked by a
+ * round trip. Needs no window or GL context. Exits with 1 if a check fails,
+ * so it can run in CI.
+ */
+
+#include "vaseTest.h"
+
+#include <filesystem>
+#include <iostream>
+
+namespace vasetest {
+
+namespace {
+int failures = 0;
+}
+
+std::vector<Case>& cases() {
+    static std::vector<Case> all;
+    return all;
+}
+
+void fail(const char* file, int line, const std::string& message) {
+    std::cout << "  FAILED " << std::filesystem::path(file).filename().string() << ":" << line
+              << ": " << message << "\n";
+    failures++;
+}
+
+float maxDifference(ofxVase::Rasterizer& a, ofxVase::Rasterizer& b, int channel,
+                    const ofRectangle& rect) {
+    a.finish();
+    b.finish();
+    int x0 = 0, y0 = 0, x1 = a.getWidth(), y1 = a.getHeight();
+    if (rect.width > 0 && rect.height > 0) {
+        x0 = std::max(x0, static_cast<int>(rect.getLeft()));
+        y0 = std::max(y0, static_cast<int>(rect.getTop()));
+        x1 = std::min(x1, static_cast<int>(rect.getRight()));
+        y1 = std::min(y1, static_cast<int>(rect.getBottom()));
+    }
+    const float* pa = a.getChannel(channel);
+    const float* pb = b.getChannel(channel);
+    float worst = 0;
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            size_t i = static_cast<size_t>(y) * a.getWidth() + x;
+            worst = std::max(worst, std::abs(pa[i] - pb[i]));
+        }
+    }
+    return worst;
+}
+
+std::string tempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("ofxVase-" + name)).string();
+}
+
+} // namespace vasetest
+
+namespace {
+
+const char* usage =
+    "usage: vase-tests [options]\n"
+    "\n"
+    "  --only NAME   run only the cases whose name starts with NAME\n"
+    "  --list        print the case names\n"
+    "  -h, --help\n";
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string only;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--only" && i + 1 < argc) {
+            only = argv[++i];
+        } else if (arg == "--list") {
+            for (const auto& c : vasetest::cases()) std::cout << c.name << "\n";
+            return 0;
+        } else {
+            std::cout << usage;
+            return arg == "-h" || arg == "--help" ? 0 : 2;
+        }
+    }
+
+    int run = 0, failed = 0;
+    for (const auto& c : vasetest::cases()) {
+        if (std::string(c.name).compare(0, only.size(), only) != 0) continue;
+        int before = vasetest::failures;
+        std::cout << c.name << "\n";
+        c.run();
+        run++;
+        if (vasetest::failures > before) failed++;
+    }
+    std::cout << run - failed << " of " << run << " cases passed\n";
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+// SIMD batch kernels: the lanes agree with the scalar remainder loop. Each
+// kernel runs over a whole stroke, then once per entry on a window too short
+// for a lane, which the scalar instantiation handles alone.
+
+#include "vaseTest.h"
+#include "ofxVaseBatch.h"
+
+#include <iostream>
+
+using namespace ofxVase;
+
+namespace {
+
+// Positions to 1e-4 px as ofxVaseBatch.h documents, relaxed to 1e-5 relative
+// for FMA builds
+bool close(float a, float b) {
+    return std::abs(a - b) <= 1e-4f + 1e-5f * std::max(std::abs(a), std::abs(b));
+}
+
+struct Stroke {
+    std::vector<float> x, y, w, t, r;
+};
+
+// A jittered zigzag around (300, 300) with widths from sub-pixel to 20 px,
+// repeated points and steps in width too large for the segment
+Stroke makeStroke(int n) {
+    Stroke s;
+    uint32_t seed = 12345;
+    auto next = [&] { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / float(1 << 24); };
+    for (int i = 0; i < n; i++) {
+        float x = 300 + i * 3.0f + next() * 4;
+        float y = 300 + (i % 2 ? 10 : -10) * next();
+        if (i % 11 == 5) { x = s.x.back(); y = s.y.back(); }
+        s.x.push_back(x);
+        s.y.push_back(y);
+        s.w.push_back(i % 13 == 7 ? 20.0f : 0.3f + next() * 8);
+    }
+    s.t.resize(n);
+    s.r.resize(n);
+    batch::determineTr(s.w.data(), s.t.data(), s.r.data(), n, 1.0f, 1.0f);
+    return s;
+}
+
+} // namespace
+
+VASE_TEST(batchKernelsMatchScalar) {
+    std::cout << "  kernels built for " << batch::instructionSet() << "\n";
+    const int n = 103;  // not a multiple of any lane width
+    Stroke s = makeStroke(n);
+
+    // determineTr, with a scale and feathering
+    std::vector<float> t(n), r(n);
+    batch::determineTr(s.w.data(), t.data(), r.data(), n, 1.5f, 0.5f);
+    int bad = 0;
+    for (int i = 0; i < n; i++) {
+        float t1, r1;
+        batch::determineTr(&s.w[i], &t1, &r1, 1, 1.5f, 0.5f);
+        bad += !close(t[i], t1) || !close(r[i], r1);
+    }
+    VASE_CHECK_EQ(bad, 0);
+
+    // segmentTangents: segment i alone is a two-point stroke
+    std::vector<float> ntx(n), nty(n), nbx(n), nby(n);
+    std::vector<int32_t> degenerate(n);
+    batch::segmentTangents(s.x.data(), s.y.data(), s.t.data(), s.r.data(), n,
+                           ntx.data(), nty.data(), nbx.data(), nby.data(), degenerate.data());
+    bad = 0;
+    int degenerateCount = 0;
+    for (int i = 0; i < n - 1; i++) {
+        float tx, ty, bx, by;
+        int32_t d;
+        batch::segmentTangents(&s.x[i], &s.y[i], &s.t[i], &s.r[i], 2, &tx, &ty, &bx, &by, &d);
+        bad += d != degenerate[i] || !close(ntx[i], tx) || !close(nty[i], ty) ||
+               !close(nbx[i], bx) || !close(nby[i], by);
+        degenerateCount += degenerate[i] != 0;
+    }
+    VASE_CHECK_EQ(bad, 0);
+    VASE_CHECK(degenerateCount > 0);  // the repeated points are covered
+
+    // innerMiters: joint i alone is the middle of a three-point stroke
+    std::vector<float> coreX(n), coreY(n), fadeX(n), fadeY(n);
+    std::vector<int32_t> valid(n), topInner(n);
+    batch::innerMiters(s.x.data(), s.y.data(), s.t.data(), s.r.data(),
+                       ntx.data(), nty.data(), nbx.data(), nby.data(), degenerate.data(), n,
+                       coreX.data(), coreY.data(), fadeX.data(), fadeY.data(),
+                       valid.data(), topInner.data());
+    bad = 0;
+    int validCount = 0;
+    for (int i = 1; i < n - 1; i++) {
+        float cx[3], cy[3], fx[3], fy[3];
+        int32_t v[3], top[3];
+        int k = i - 1;
+        batch::innerMiters(&s.x[k], &s.y[k], &s.t[k], &s.r[k], &ntx[k], &nty[k], &nbx[k], &nby[k],
+                           &degenerate[k], 3, cx, cy, fx, fy, v, top);
+        bad += v[1] != valid[i];
+        if (valid[i]) {
+            bad += top[1] != topInner[i] || !close(cx[1], coreX[i]) || !close(cy[1], coreY[i]) ||
+                   !close(fx[1], fadeX[i]) || !close(fy[1], fadeY[i]);
+            validCount++;
+        }
+    }
+    VASE_CHECK_EQ(bad, 0);
+    VASE_CHECK(validCount > 0);
+    VASE_CHECK_EQ(valid[0], 0);
+    VASE_CHECK_EQ(valid[n - 1], 0);
+}
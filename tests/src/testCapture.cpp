@@ -0,0 +1,96 @@
+// Capture: a log of rebuilds replays to the same tessellation, and a log cut
+// short keeps its complete records. The draw functions need a GL context, so
+// these cases capture rebuilds only.
+
+#include "vaseTest.h"
+#include "ofxVaseCapture.h"
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace ofxVase;
+
+namespace {
+
+// Records a few rebuilds of every kind; returns the vertices they made
+size_t recordStrokes() {
+    std::vector<glm::vec2> points;
+    std::vector<ofFloatColor> colors;
+    std::vector<float> widths;
+    for (int i = 0; i < 40; i++) {
+        points.emplace_back(i * 6.0f, 100 + 30 * std::sin(i * 0.4f));
+        colors.emplace_back(i / 40.0f, 0.5f, 1, 1);
+        widths.push_back(1 + (i % 5));
+    }
+    Options smooth;
+    smooth.setAdaptiveSmoothing(0.5f).setJoint(JointStyle::Miter);
+
+    size_t vertices = 0;
+    Polyline constant(points, ofFloatColor(1, 1, 1, 1), 3.0f);
+    Polyline varying(points, colors, widths, smooth);
+    Segment segment(points[0], points[1], colors[0], colors[1], 2.0f, 5.0f);
+    vertices += constant.holder.getCount() + varying.holder.getCount() + segment.holder.getCount();
+
+    // On a worker thread too
+    std::thread([&] {
+        Polyline worker(points, ofFloatColor(1, 0, 0, 1), 8.0f, smooth);
+        vertices += worker.holder.getCount();
+    }).join();
+
+    // Not while paused
+    capture::Pause pause;
+    Polyline hidden(points, ofFloatColor(1, 1, 1, 1), 3.0f);
+    return vertices;
+}
+
+} // namespace
+
+VASE_TEST(captureRoundTrip) {
+    std::string path = vasetest::tempPath("capture.vasc");
+    VASE_CHECK(startCapture(path, true));
+    size_t vertices = recordStrokes();
+    stopCapture();
+    VASE_CHECK(!isCapturing());
+
+    CaptureReplay replay;
+    VASE_CHECK(replay.load(path));
+    VASE_CHECK_EQ(replay.getFrameCount(), size_t(1));
+    if (replay.getFrameCount() != 1) return;
+    replay.run(2);
+    const CaptureReplay::Frame& frame = replay.getFrame(0);
+    VASE_CHECK_EQ(frame.polylines, size_t(4));
+    VASE_CHECK_EQ(frame.points, size_t(3 * 40 + 2));
+    VASE_CHECK_EQ(frame.cacheHits, size_t(0));
+    VASE_CHECK_EQ(frame.vertices, vertices);
+    replay.close();
+
+    // Without rebuilds, only the draw API is logged
+    VASE_CHECK(startCapture(path));
+    recordStrokes();
+    stopCapture();
+    VASE_CHECK(replay.load(path));
+    VASE_CHECK_EQ(replay.getFrameCount(), size_t(0));
+    replay.close();
+    std::filesystem::remove(path);
+}
+
+VASE_TEST(captureTruncatedLog) {
+    std::string path = vasetest::tempPath("capture-cut.vasc");
+    VASE_CHECK(startCapture(path, true));
+    recordStrokes();
+    stopCapture();
+
+    // Cut into the last record: the first three still replay
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 10);
+    CaptureReplay replay;
+    VASE_CHECK(replay.load(path));
+    VASE_CHECK_EQ(replay.getFrameCount(), size_t(1));
+    if (replay.getFrameCount() == 1) VASE_CHECK_EQ(replay.getFrame(0).polylines, size_t(3));
+    replay.close();
+
+    // Not a log at all
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a capture log";
+    VASE_CHECK(!replay.load(path));
+    std::filesystem::remove(path);
+}
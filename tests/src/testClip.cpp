@@ -0,0 +1,65 @@
+// Viewport clipping: inside the clip rect the stroke is the unclipped one
+
+#include "vaseTest.h"
+
+using namespace ofxVase;
+
+namespace {
+
+// A wave from well left of the canvas to well right of it
+std::vector<glm::vec2> wave() {
+    std::vector<glm::vec2> points;
+    for (int i = 0; i <= 200; i++) {
+        float t = i / 200.0f;
+        points.emplace_back(-100 + t * 456, 128 + 100 * std::sin(t * 12));
+    }
+    return points;
+}
+
+} // namespace
+
+VASE_TEST(clipMatchesUnclippedInsideRect) {
+    std::vector<glm::vec2> points = wave();
+    std::vector<float> widths;
+    for (size_t i = 0; i < points.size(); i++) widths.push_back(2 + (i % 7));
+    std::vector<ofFloatColor> white = { ofFloatColor(1, 1, 1, 1) };
+    const ofRectangle rect(64, 48, 128, 160);
+
+    for (JointStyle joint : { JointStyle::Round, JointStyle::Miter, JointStyle::Bevel }) {
+        Options opt;
+        opt.joint = joint;
+        opt.cap = CapStyle::Square;
+        Options clipped = opt;
+        clipped.setClipRect(rect);
+
+        for (bool constant : { true, false }) {
+            Polyline full, part;
+            if (constant) {
+                full.rebuild(points, white[0], 6.0f, opt);
+                part.rebuild(points, white[0], 6.0f, clipped);
+            } else {
+                full.rebuild(points, white, widths, opt);
+                part.rebuild(points, white, widths, clipped);
+            }
+            VASE_CHECK_LE(part.holder.getCount(), full.holder.getCount() / 2);
+
+            Rasterizer a(256, 256), b(256, 256);
+            a.draw(full);
+            b.draw(part);
+            VASE_CHECK_LE(vasetest::maxDifference(a, b, 3, rect), 1e-3f);
+        }
+    }
+}
+
+VASE_TEST(clipDropsStrokesOutsideRect) {
+    std::vector<glm::vec2> points = wave();
+    Options opt;
+    opt.setClipRect(ofRectangle(1000, 1000, 10, 10));
+    Polyline line(points, ofFloatColor(1, 1, 1, 1), 4.0f, opt);
+    VASE_CHECK_EQ(line.holder.getCount(), 0);
+
+    // A rect the end cap reaches, though no point is inside it, keeps the stroke
+    opt.setClipRect(ofRectangle(points.back().x + 1, points.back().y - 5, 10, 10));
+    line.rebuild(points, ofFloatColor(1, 1, 1, 1), 4.0f, opt);
+    VASE_CHECK(line.holder.getCount() > 0);
+}
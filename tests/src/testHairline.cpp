@@ -0,0 +1,65 @@
+// Hairlines: the cheap kernel stays close to the swept-disc reference and puts
+// down the ink of the full path; wider strokes don't take it
+
+#include "vaseTest.h"
+#include "ofxVaseAccuracy.h"
+
+using namespace ofxVase;
+
+namespace {
+
+// 61 points of a bumpy wave, turns of every size
+std::vector<glm::vec2> wave() {
+    std::vector<glm::vec2> points;
+    for (int i = 0; i <= 60; i++) {
+        float t = i / 60.0f;
+        points.emplace_back(20 + t * 216, 128 + 80 * std::sin(t * 9) + (i % 3) * 2);
+    }
+    return points;
+}
+
+} // namespace
+
+VASE_TEST(hairlineAccuracy) {
+    std::vector<glm::vec2> points = wave();
+    AccuracyHarness harness(256, 256, 4);
+    Options full;
+    Options hairline;
+    hairline.setHairline(2.0f);
+
+    for (float width : { 0.5f, 1.0f, 1.5f, 2.0f }) {
+        AccuracyReport thin = harness.measure(points, WidthView(&width, 1), hairline);
+        VASE_CHECK_EQ(thin.gapPixels, 0);
+        VASE_CHECK_LE(thin.maxError, 0.4f);
+        VASE_CHECK_LE(thin.rmsError, 0.16f);
+
+        // Under a pixel the full path over-inks, so compare from one pixel up
+        if (width >= 1.0f) {
+            AccuracyReport exact = harness.measure(points, WidthView(&width, 1), full);
+            VASE_CHECK_LE(std::abs(thin.inkRatio - exact.inkRatio), 0.05f);
+        }
+
+        Polyline a(points, ofFloatColor(1, 1, 1, 1), width, full);
+        Polyline b(points, ofFloatColor(1, 1, 1, 1), width, hairline);
+        VASE_CHECK_LE(b.holder.getCount() * 4, a.holder.getCount());
+    }
+}
+
+VASE_TEST(hairlineLinesAndLimit) {
+    std::vector<glm::vec2> points = wave();
+    Options lines;
+    lines.setHairline(2.0f, true);
+    Polyline line(points, ofFloatColor(1, 1, 1, 1), 1.0f, lines);
+    VASE_CHECK_EQ(line.holder.glmode, VertexArrayHolder::DRAW_LINES);
+    VASE_CHECK_EQ(line.holder.getCount(), static_cast<int>(points.size() - 1) * 2);
+
+    // Past hairlineWidth the stroke is the full one
+    Polyline wide(points, ofFloatColor(1, 1, 1, 1), 3.0f, lines);
+    Polyline reference(points, ofFloatColor(1, 1, 1, 1), 3.0f, Options());
+    VASE_CHECK_EQ(wide.holder.glmode, reference.holder.glmode);
+    VASE_CHECK_EQ(wide.holder.getCount(), reference.holder.getCount());
+    Rasterizer a(256, 256), b(256, 256);
+    a.draw(wide);
+    b.draw(reference);
+    VASE_CHECK_EQ(vasetest::maxDifference(a, b, 3), 0.0f);
+}
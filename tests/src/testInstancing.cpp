@@ -0,0 +1,82 @@
+// Instanced drawing: the CPU fallback draws what the instancing shader does,
+// and that is the stroke tessellated in place for rigid instances. The GPU
+// path itself needs a GL context and is not run here.
+
+#include "vaseTest.h"
+
+using namespace ofxVase;
+
+namespace {
+
+const std::vector<glm::vec2> icon = { { -20, -5 }, { 0, 10 }, { 15, -8 }, { 25, 6 } };
+
+std::vector<Instance> rigidInstances() {
+    std::vector<Instance> instances;
+    for (int i = 0; i < 6; i++) {
+        instances.emplace_back(glm::vec2(40 + i * 35, 60 + (i % 2) * 40), i * 0.7f, 1.0f,
+                               ofFloatColor(1, i / 5.0f, 1 - i / 5.0f, 1));
+    }
+    return instances;
+}
+
+} // namespace
+
+VASE_TEST(instancesMatchShader) {
+    std::vector<Instance> instances = rigidInstances();
+    instances.emplace_back(glm::vec2(10, 10), 0.3f, 2.5f, ofFloatColor(0.5f, 0.5f, 0.5f, 0.5f));
+    Polyline stroke(icon, ofFloatColor(1, 1, 1, 1), 4.0f);
+
+    VertexArrayHolder out;
+    Renderer::transformInstances(stroke.holder, instances.data(), instances.size(), out);
+    size_t n = stroke.holder.vertices.size();
+    VASE_CHECK_EQ(out.glmode, stroke.holder.glmode);
+    VASE_CHECK_EQ(out.vertices.size(), n * instances.size());
+
+    // The vertex shader: axes.xy * x + axes.zw * y + offset, color * tint
+    int wrong = 0;
+    for (size_t i = 0; i < instances.size(); i++) {
+        const Instance& in = instances[i];
+        for (size_t j = 0; j < n; j++) {
+            const glm::vec3& p = stroke.holder.vertices[j];
+            glm::vec2 expected = in.axisX * p.x + in.axisY * p.y + in.offset;
+            const glm::vec3& v = out.vertices[i * n + j];
+            const ofFloatColor& c = stroke.holder.colors[j];
+            const ofFloatColor& oc = out.colors[i * n + j];
+            wrong += glm::length(glm::vec2(v) - expected) > 1e-4f || v.z != p.z ||
+                     std::abs(oc.g - c.g * in.tint.g) > 1e-6f || std::abs(oc.a - c.a * in.tint.a) > 1e-6f;
+        }
+    }
+    VASE_CHECK_EQ(wrong, 0);
+}
+
+VASE_TEST(instancesMatchTessellatedCopies) {
+    std::vector<Instance> instances = rigidInstances();
+    Polyline stroke(icon, ofFloatColor(1, 1, 1, 1), 4.0f);
+    VertexArrayHolder out;
+    Renderer::transformInstances(stroke.holder, instances.data(), instances.size(), out);
+
+    // Rotating and moving a stroke doesn't change its fade, so each copy is the
+    // stroke tessellated at its place, up to the rounding of the triangles
+    Rasterizer a(256, 160), b(256, 160);
+    a.draw(out);
+    for (const Instance& in : instances) {
+        std::vector<glm::vec2> placed;
+        for (const glm::vec2& p : icon) placed.push_back(in.apply(p));
+        b.draw(Polyline(placed, in.tint, 4.0f));
+    }
+    for (int channel = 0; channel < 4; channel++) {
+        VASE_CHECK_LE(vasetest::maxDifference(a, b, channel), 0.03f);
+    }
+}
+
+VASE_TEST(instancesOfStrips) {
+    // Strips become triangles so the copies don't join up
+    VertexArrayHolder strip;
+    strip.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLE_STRIP);
+    for (int i = 0; i < 6; i++) strip.push(glm::vec2(i * 4, (i % 2) * 4), ofFloatColor(1, 1, 1, 1));
+    std::vector<Instance> instances = rigidInstances();
+    VertexArrayHolder out;
+    Renderer::transformInstances(strip, instances.data(), instances.size(), out);
+    VASE_CHECK_EQ(out.glmode, VertexArrayHolder::DRAW_TRIANGLES);
+    VASE_CHECK_EQ(out.vertices.size(), size_t(4 * 3) * instances.size());
+}
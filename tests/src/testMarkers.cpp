@@ -0,0 +1,89 @@
+// MarkerBatch: each disc is close to the exact disc, the vertex estimate is
+// exact, and per-center radii and colors land on their own disc
+
+#include "vaseTest.h"
+
+using namespace ofxVase;
+
+namespace {
+
+// Coverage of the exact disc over pixel (x, y), 8 x 8 samples
+float discCoverage(int x, int y, const glm::vec2& center, float radius) {
+    int inside = 0;
+    for (int sy = 0; sy < 8; sy++) {
+        for (int sx = 0; sx < 8; sx++) {
+            glm::vec2 q(x + (sx + 0.5f) / 8, y + (sy + 0.5f) / 8);
+            inside += glm::length(q - center) <= radius;
+        }
+    }
+    return inside / 64.0f;
+}
+
+} // namespace
+
+VASE_TEST(markerAccuracy) {
+    const glm::vec2 center(64.3f, 64.6f);  // off the pixel grid
+    for (float radius : { 0.7f, 1.5f, 3.0f, 8.0f, 40.0f }) {
+        MarkerBatch markers;
+        markers.add(center, radius, ofFloatColor(1, 1, 1, 1));
+        VASE_CHECK_EQ(markers.size(), size_t(1));
+        VASE_CHECK_EQ(static_cast<size_t>(markers.holder.getCount()),
+                      MarkerBatch::estimateVertexCount(1, WidthView(&radius, 1)));
+
+        // White over black: red is the coverage
+        Rasterizer canvas(128, 128);
+        canvas.draw(markers.holder);
+        canvas.finish();
+        float worst = 0;
+        double squared = 0, ink = 0, reference = 0;
+        int compared = 0;
+        for (int y = 0; y < 128; y++) {
+            for (int x = 0; x < 128; x++) {
+                float expected = discCoverage(x, y, center, radius);
+                float actual = canvas.getChannel(0)[y * 128 + x];
+                if (expected == 0 && actual == 0) continue;
+                worst = std::max(worst, std::abs(actual - expected));
+                squared += (actual - expected) * (actual - expected);
+                ink += actual;
+                reference += expected;
+                compared++;
+            }
+        }
+        VASE_CHECK_LE(worst, 0.25f);
+        VASE_CHECK_LE(std::sqrt(squared / compared), 0.06);
+        // Sub-pixel dots lose some ink to the fade, as thin strokes do
+        VASE_CHECK_LE(std::abs(ink / reference - 1), radius < 1 ? 0.2 : 0.05);
+    }
+}
+
+VASE_TEST(markerBatchPerCenter) {
+    std::vector<glm::vec2> centers;
+    std::vector<float> radii;
+    std::vector<ofFloatColor> colors;
+    for (int i = 0; i < 6; i++) {
+        centers.emplace_back(20 + i * 40, 40);
+        radii.push_back(2.0f + i * 3);
+        colors.push_back(i % 2 ? ofFloatColor(1, 0, 0, 1) : ofFloatColor(0, 0, 1, 1));
+    }
+    MarkerBatch markers;
+    markers.add(centers, radii, colors);
+    VASE_CHECK_EQ(markers.size(), centers.size());
+    VASE_CHECK_EQ(static_cast<size_t>(markers.holder.getCount()),
+                  MarkerBatch::estimateVertexCount(centers.size(), radii));
+
+    Rasterizer canvas(256, 80);
+    canvas.draw(markers.holder);
+    canvas.finish();
+    for (size_t i = 0; i < centers.size(); i++) {
+        size_t at = static_cast<size_t>(centers[i].y) * 256 + static_cast<size_t>(centers[i].x);
+        VASE_CHECK_EQ(canvas.getChannel(0)[at], colors[i].r);
+        VASE_CHECK_EQ(canvas.getChannel(2)[at], colors[i].b);
+        // Just outside its radius, clear of the fade
+        size_t beside = at + static_cast<size_t>(radii[i] + 2);
+        VASE_CHECK_EQ(canvas.getChannel(3)[beside], 0.0f);
+    }
+
+    markers.clear();
+    VASE_CHECK_EQ(markers.size(), size_t(0));
+    VASE_CHECK_EQ(markers.holder.getCount(), 0);
+}
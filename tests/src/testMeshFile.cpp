@@ -0,0 +1,91 @@
+// Mesh files: strokes written plain or indexed load back vertex for vertex,
+// strips as the triangles they draw; damaged files are refused
+
+#include "vaseTest.h"
+#include "ofxVaseMeshFile.h"
+
+#include <filesystem>
+
+using namespace ofxVase;
+
+namespace {
+
+std::vector<VertexArrayHolder> strokes() {
+    std::vector<glm::vec2> points;
+    std::vector<ofFloatColor> colors;
+    std::vector<float> widths;
+    for (int i = 0; i < 30; i++) {
+        points.emplace_back(10 + i * 5.0f, 50 + 20 * std::sin(i * 0.5f));
+        colors.emplace_back(1, i / 30.0f, 0, 1);
+        widths.push_back(2 + (i % 4));
+    }
+    std::vector<VertexArrayHolder> all;
+    all.push_back(Polyline(points, ofFloatColor(1, 1, 1, 1), 3.0f).holder);
+    all.push_back(Polyline(points, colors, widths).holder);
+
+    VertexArrayHolder strip;
+    strip.setGlDrawMode(VertexArrayHolder::DRAW_TRIANGLE_STRIP);
+    for (int i = 0; i < 8; i++) strip.push(glm::vec2(i * 3, (i % 2) * 3), ofFloatColor(0, 0, 1, 1));
+    all.push_back(strip);
+    return all;
+}
+
+} // namespace
+
+VASE_TEST(meshFileRoundTrip) {
+    std::vector<VertexArrayHolder> written = strokes();
+    for (bool indexed : { false, true }) {
+        std::string path = vasetest::tempPath(indexed ? "indexed.vasm" : "plain.vasm");
+        MeshFileWriter writer(indexed);
+        for (const VertexArrayHolder& holder : written) writer.add(holder);
+        VASE_CHECK(writer.save(path));
+
+        MeshFile file;
+        VASE_CHECK(file.load(path));
+        VASE_CHECK_EQ(file.isIndexed(), indexed);
+        VASE_CHECK_EQ(file.getStrokeCount(), written.size());
+        if (file.getStrokeCount() != written.size()) continue;
+
+        for (size_t s = 0; s < written.size(); s++) {
+            VertexArrayHolder triangles;
+            triangles.push(written[s]);  // strips as triangles, the way they are saved
+            const MeshFile::Stroke& stroke = file.getStroke(s);
+            size_t count = indexed ? stroke.indexCount : stroke.vertexCount;
+            VASE_CHECK_EQ(count, triangles.vertices.size());
+            if (count != triangles.vertices.size()) continue;
+
+            int wrong = 0;
+            glm::vec2 low(triangles.vertices[0]), high(triangles.vertices[0]);
+            for (size_t k = 0; k < count; k++) {
+                size_t v = indexed ? file.getIndices()[stroke.firstIndex + k] : stroke.firstVertex + k;
+                wrong += v < stroke.firstVertex || v >= stroke.firstVertex + stroke.vertexCount ||
+                         file.getPositions()[v] != glm::vec2(triangles.vertices[k]) ||
+                         file.getColors()[v] != triangles.colors[k];
+                low = glm::min(low, glm::vec2(triangles.vertices[k]));
+                high = glm::max(high, glm::vec2(triangles.vertices[k]));
+            }
+            VASE_CHECK_EQ(wrong, 0);
+            VASE_CHECK(stroke.left == low.x && stroke.top == low.y);
+            VASE_CHECK(stroke.right == high.x && stroke.bottom == high.y);
+        }
+        // Vertices merge only within a stroke, so strokes stay apart
+        if (indexed) VASE_CHECK(file.getVertexCount() < file.getIndexCount());
+
+        file.close();
+        VASE_CHECK(!file.isMapped());
+        std::filesystem::remove(path);
+    }
+}
+
+VASE_TEST(meshFileRefusesDamage) {
+    std::string path = vasetest::tempPath("cut.vasm");
+    MeshFileWriter writer;
+    for (const VertexArrayHolder& holder : strokes()) writer.add(holder);
+    VASE_CHECK(writer.save(path));
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    MeshFile file;
+    VASE_CHECK(!file.load(path));
+    VASE_CHECK(!file.load(vasetest::tempPath("missing.vasm")));
+    std::filesystem::remove(path);
+}
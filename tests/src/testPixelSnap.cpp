@@ -0,0 +1,88 @@
+// Pixel snapping: axis-aligned outlines land on whole pixels, with no fade and
+// no doubled corners; anything with a diagonal takes the normal path
+
+#include "vaseTest.h"
+
+using namespace ofxVase;
+
+namespace {
+
+struct Box {
+    int left, top, right, bottom;  // pixels, right and bottom exclusive
+    bool contains(int x, int y) const { return x >= left && x < right && y >= top && y < bottom; }
+};
+
+} // namespace
+
+VASE_TEST(pixelSnapRectOutline) {
+    // The outline of (10, 10) - (50, 30) covers the pixels of outer but not inner
+    struct Golden {
+        float width;
+        Box outer, inner;
+        float coverage;
+    };
+    const Golden goldens[] = {
+        { 1.0f, { 10, 10, 51, 31 }, { 11, 11, 50, 30 }, 1.0f },
+        { 2.0f, { 9, 9, 51, 31 }, { 11, 11, 49, 29 }, 1.0f },
+        { 3.0f, { 9, 9, 52, 32 }, { 12, 12, 49, 29 }, 1.0f },
+        { 0.5f, { 10, 10, 51, 31 }, { 11, 11, 50, 30 }, 0.5f },  // thinner: partial alpha, same ink
+    };
+    const std::vector<glm::vec2> rect = { { 10, 10 }, { 50, 10 }, { 50, 30 }, { 10, 30 }, { 10, 10 } };
+    Options opt;
+    opt.setPixelSnap(true);
+
+    for (const Golden& g : goldens) {
+        Polyline outline(rect, ofFloatColor(1, 1, 1, 1), g.width, opt);
+        VASE_CHECK_EQ(outline.holder.getCount(), 4 * 6);
+
+        // White over black: red is the coverage
+        Rasterizer canvas(64, 64);
+        canvas.setLayerCounting(true);
+        canvas.draw(outline);
+        canvas.finish();
+        int wrong = 0, doubled = 0;
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                float expected = g.outer.contains(x, y) && !g.inner.contains(x, y) ? g.coverage : 0.0f;
+                wrong += canvas.getChannel(0)[y * 64 + x] != expected;
+                doubled += canvas.getLayers()[y * 64 + x] > 1;
+            }
+        }
+        VASE_CHECK_EQ(wrong, 0);
+        VASE_CHECK_EQ(doubled, 0);
+    }
+}
+
+VASE_TEST(pixelSnapCapsAndDiagonals) {
+    Options opt;
+    opt.setPixelSnap(true);
+
+    // An open corner is capped: half the width past each end
+    const std::vector<glm::vec2> corner = { { 10, 10 }, { 50, 10 }, { 50, 30 } };
+    Polyline open(corner, ofFloatColor(1, 1, 1, 1), 2.0f, opt);
+    Rasterizer canvas(64, 64);
+    canvas.draw(open);
+    canvas.finish();
+    Box bounds = { 64, 64, 0, 0 };
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 64; x++) {
+            if (canvas.getChannel(0)[y * 64 + x] == 0) continue;
+            bounds = { std::min(bounds.left, x), std::min(bounds.top, y),
+                       std::max(bounds.right, x + 1), std::max(bounds.bottom, y + 1) };
+        }
+    }
+    VASE_CHECK_EQ(bounds.left, 9);
+    VASE_CHECK_EQ(bounds.top, 9);
+    VASE_CHECK_EQ(bounds.right, 51);
+    VASE_CHECK_EQ(bounds.bottom, 31);
+
+    // One diagonal segment and the whole stroke is tessellated as usual
+    const std::vector<glm::vec2> slanted = { { 10, 10 }, { 50, 10 }, { 40, 30 } };
+    Polyline snapped(slanted, ofFloatColor(1, 1, 1, 1), 2.0f, opt);
+    Polyline normal(slanted, ofFloatColor(1, 1, 1, 1), 2.0f, Options());
+    VASE_CHECK_EQ(snapped.holder.getCount(), normal.holder.getCount());
+    Rasterizer a(64, 64), b(64, 64);
+    a.draw(snapped);
+    b.draw(normal);
+    VASE_CHECK_EQ(vasetest::maxDifference(a, b, 0), 0.0f);
+}
@@ -0,0 +1,68 @@
+#pragma once
+/*
+ * vase-tests - Case registry and checks
+ *
+ * Each test*.cpp defines its cases with VASE_TEST; main.cpp runs them. A
+ * failed check prints where and what, and the case carries on, so one run
+ * shows every difference.
+ */
+
+#include "ofMain.h"
+#include "ofxVase.h"
+#include "ofxVaseRaster.h"
+
+#include <sstream>
+
+namespace vasetest {
+
+struct Case {
+    const char* name;
+    void (*run)();
+};
+
+std::vector<Case>& cases();
+
+struct Register {
+    Register(const char* name, void (*run)()) { cases().push_back({ name, run }); }
+};
+
+void fail(const char* file, int line, const std::string& message);
+
+// Largest difference of a channel between two canvases of the same size,
+// over the pixels of rect (the whole canvas if rect is empty)
+float maxDifference(ofxVase::Rasterizer& a, ofxVase::Rasterizer& b, int channel,
+                    const ofRectangle& rect = ofRectangle());
+
+// Scratch file path in the system temp folder
+std::string tempPath(const std::string& name);
+
+} // namespace vasetest
+
+#define VASE_TEST(name) \
+    static void name(); \
+    static vasetest::Register name##Registration(#name, name); \
+    static void name()
+
+#define VASE_CHECK(condition) \
+    do { if (!(condition)) vasetest::fail(__FILE__, __LINE__, #condition); } while (0)
+
+// Fails unless a <= b, printing both values
+#define VASE_CHECK_LE(a, b) \
+    do { \
+        auto vaseA = (a); auto vaseB = (b); \
+        if (!(vaseA <= vaseB)) { \
+            std::ostringstream vaseMessage; \
+            vaseMessage << #a << " <= " << #b << " (" << vaseA << " > " << vaseB << ")"; \
+            vasetest::fail(__FILE__, __LINE__, vaseMessage.str()); \
+        } \
+    } while (0)
+
+#define VASE_CHECK_EQ(a, b) \
+    do { \
+        auto vaseA = (a); auto vaseB = (b); \
+        if (!(vaseA == vaseB)) { \
+            std::ostringstream vaseMessage; \
+            vaseMessage << #a << " == " << #b << " (" << vaseA << " != " << vaseB << ")"; \
+            vasetest::fail(__FILE__, __LINE__, vaseMessage.str()); \
+        } \
+    } while (0)
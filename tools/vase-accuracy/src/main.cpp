@@ -0,0 +1,202 @@
+/*
+ * vase-accuracy - Error of ofxVase output per Options knob
+ *
+ * Tessellates a fixed set of test strokes with each quality or performance
+ * setting and compares the rasterized coverage with the analytic swept-disc
+ * coverage (see ofxVaseAccuracy.h). Prints one row per setting and stroke:
+ * max and RMS coverage error, gap pixels, ink ratio and overdraw.
+ *
+ * The reference has round joints and caps, so the joint and cap rows include
+ * the intended shape difference; compare them with each other, not with zero.
+ */
+
+#include "ofMain.h"
+#include "ofxVase.h"
+#include "ofxVaseAccuracy.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+const char* usage =
+    "usage: vase-accuracy [options]\n"
+    "\n"
+    "  --width W             stroke width of the constant-width strokes; repeatable\n"
+    "                        (default: 1.5, 4 and 12)\n"
+    "  --samples N           reference samples per pixel axis, 1..8 (8)\n"
+    "  --only NAME           run only the settings whose name starts with NAME\n"
+    "  --maps DIR            write an error map per row into DIR (red: too much\n"
+    "                        coverage, blue: too little)\n"
+    "  -j, --threads N       worker threads (all cores)\n"
+    "  -h, --help\n";
+
+constexpr int canvasSize = 512;
+
+struct Settings {
+    std::vector<float> widths;
+    int samples = 8;
+    std::string only;
+    std::string maps;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+struct Stroke {
+    std::string name;
+    std::vector<glm::vec2> points;
+    std::vector<float> widths;   // one value: constant width
+};
+
+struct Knob {
+    std::string name;
+    ofxVase::Options opt;
+};
+
+bool parseArgs(int argc, char** argv, Settings& s) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg == "--width") {
+            s.widths.push_back(std::stof(value()));
+        } else if (arg == "--samples") {
+            s.samples = std::stoi(value());
+        } else if (arg == "--only") {
+            s.only = value();
+        } else if (arg == "--maps") {
+            s.maps = value();
+        } else if (arg == "-j" || arg == "--threads") {
+            s.threads = std::max(1, std::stoi(value()));
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    if (s.widths.empty()) s.widths = { 1.5f, 4.0f, 12.0f };
+    return true;
+}
+
+// ============================================================================
+// Test strokes and settings
+// ============================================================================
+
+std::vector<Stroke> makeStrokes(const std::vector<float>& widths) {
+    std::vector<Stroke> strokes;
+    const float pi = glm::pi<float>();
+
+    for (float w : widths) {
+        std::string suffix = " w" + ofToString(w);
+
+        // Gentle curve, sampled finely enough for the approximate strips
+        Stroke curve{ "curve" + suffix, {}, { w } };
+        for (int i = 0; i <= 120; i++) {
+            float t = i / 120.0f;
+            curve.points.push_back({ 40 + 430 * t, 256 + 150 * std::sin(t * 2 * pi) });
+        }
+        strokes.push_back(curve);
+
+        // Sharp turns of 30 to 170 degrees: joints and miters
+        Stroke zigzag{ "zigzag" + suffix, {}, { w } };
+        glm::vec2 p(60, 80);
+        glm::vec2 dir(1, 0);
+        for (int i = 0; i < 12; i++) {
+            zigzag.points.push_back(p);
+            float turn = (30 + 140 * (i % 4) / 3.0f) * pi / 180 * (i % 2 ? 1 : -1);
+            dir = glm::vec2(dir.x * std::cos(turn) - dir.y * std::sin(turn),
+                            dir.x * std::sin(turn) + dir.y * std::cos(turn));
+            p += dir * 60.0f;
+            p.x = std::min(std::max(p.x, 40.0f), canvasSize - 40.0f);
+            p.y = std::min(std::max(p.y, 40.0f), canvasSize - 40.0f);
+        }
+        strokes.push_back(zigzag);
+
+        // A coarse circle: long segments and constant turns
+        Stroke circle{ "circle" + suffix, {}, { w } };
+        for (int i = 0; i <= 9; i++) {
+            float a = i * 2 * pi / 9;
+            circle.points.push_back({ 256 + 180 * std::cos(a), 256 + 180 * std::sin(a) });
+        }
+        strokes.push_back(circle);
+    }
+
+    // Tapering width through the exact tessellator
+    Stroke taper{ "taper", {}, {} };
+    for (int i = 0; i <= 40; i++) {
+        float t = i / 40.0f;
+        taper.points.push_back({ 50 + 410 * t, 256 + 120 * std::sin(t * 3 * pi) });
+        taper.widths.push_back(1.0f + 15.0f * std::sin(t * pi));
+    }
+    strokes.push_back(taper);
+    return strokes;
+}
+
+std::vector<Knob> makeKnobs() {
+    using ofxVase::Options;
+    std::vector<Knob> knobs;
+    knobs.push_back({ "default", Options() });
+    knobs.push_back({ "joint-miter", Options().setJoint(ofxVase::JointStyle::Miter) });
+    knobs.push_back({ "joint-bevel", Options().setJoint(ofxVase::JointStyle::Bevel) });
+    knobs.push_back({ "miter-limit-1.5", Options().setJoint(ofxVase::JointStyle::Miter).setMiterLimit(1.5f) });
+    knobs.push_back({ "cap-butt", Options().setCap(ofxVase::CapStyle::Butt) });
+    knobs.push_back({ "cap-square", Options().setCap(ofxVase::CapStyle::Square) });
+    knobs.push_back({ "feather-0.5", Options().setFeather(true, 0.5f) });
+    knobs.push_back({ "feather-2", Options().setFeather(true, 2.0f) });
+    Options noCapFeather;
+    noCapFeather.noFeatherAtCap = true;
+    knobs.push_back({ "no-feather-at-cap", noCapFeather });
+    knobs.push_back({ "smoothing-4", Options().setSmoothing(4) });
+    knobs.push_back({ "smoothing-16", Options().setSmoothing(16) });
+    knobs.push_back({ "tolerance-0.25", Options().setAdaptiveSmoothing(0.25f) });
+    knobs.push_back({ "tolerance-1", Options().setAdaptiveSmoothing(1.0f) });
+    knobs.push_back({ "quality-draft", Options().setQuality(ofxVase::Quality::Draft) });
+    knobs.push_back({ "quality-high", Options().setQuality(ofxVase::Quality::High) });
+    knobs.push_back({ "hairline-2", Options().setHairline(2.0f) });
+    knobs.push_back({ "hairline-2-lines", Options().setHairline(2.0f, true) });
+    return knobs;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Settings settings;
+    try {
+        if (!parseArgs(argc, argv, settings)) {
+            std::cout << usage;
+            return 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "vase-accuracy: " << e.what() << "\n\n" << usage;
+        return 2;
+    }
+
+    ofxVase::AccuracyHarness harness(canvasSize, canvasSize, settings.samples);
+    harness.setThreadCount(settings.threads);
+    std::vector<Stroke> strokes = makeStrokes(settings.widths);
+
+    printf("%-18s %-12s %7s %7s %6s %6s %8s %5s\n",
+           "setting", "stroke", "max", "rms", "gaps", "ink", "overdraw", "max");
+    for (const Knob& knob : makeKnobs()) {
+        if (knob.name.compare(0, settings.only.size(), settings.only) != 0) continue;
+        for (const Stroke& stroke : strokes) {
+            ofxVase::AccuracyReport r = harness.measure(stroke.points, stroke.widths, knob.opt);
+            printf("%-18s %-12s %7.3f %7.4f %6d %6.3f %8.2f %5d\n",
+                   knob.name.c_str(), stroke.name.c_str(), r.maxError, r.rmsError, r.gapPixels,
+                   r.inkRatio, r.overdraw.meanOverdraw, r.overdraw.maxLayers);
+            if (!settings.maps.empty()) {
+                ofPixels map;
+                harness.getErrorMap(map);
+                std::string name = knob.name + "-" + stroke.name + ".png";
+                std::replace(name.begin(), name.end(), ' ', '-');
+                if (!ofSaveImage(map, settings.maps + "/" + name)) {
+                    std::cerr << "vase-accuracy: cannot write " << settings.maps << "/" << name << "\n";
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
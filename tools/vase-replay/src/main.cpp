@@ -0,0 +1,128 @@
+/*
+ * vase-replay - Re-run a captured ofxVase workload
+ *
+ * Loads a log written between ofxVase::startCapture() and stopCapture() (see
+ * ofxVaseCapture.h) and tessellates every frame's polylines again, on one
+ * thread, the way the app did. Prints the totals and the frame time
+ * distribution, and the slowest frames or every frame on request, so a
+ * stutter captured on a user's machine can be profiled and fixed at a desk.
+ */
+
+#include "ofMain.h"
+#include "ofxVase.h"
+#include "ofxVaseCapture.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+const char* usage =
+    "usage: vase-replay [options] log\n"
+    "\n"
+    "  -r, --repeat N        tessellate each frame N times, keep the fastest (3)\n"
+    "  --top N               list the N slowest frames (5)\n"
+    "  --frames              list every frame, in capture order\n"
+    "  -h, --help\n";
+
+struct Settings {
+    int repeat = 3;
+    int top = 5;
+    bool frames = false;
+    std::string log;
+};
+
+bool parseArgs(int argc, char** argv, Settings& s) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg == "-r" || arg == "--repeat") {
+            s.repeat = std::max(1, std::stoi(value()));
+        } else if (arg == "--top") {
+            s.top = std::max(0, std::stoi(value()));
+        } else if (arg == "--frames") {
+            s.frames = true;
+        } else if (!arg.empty() && arg[0] == '-') {
+            throw std::invalid_argument("unknown option " + arg);
+        } else if (s.log.empty()) {
+            s.log = arg;
+        } else {
+            throw std::invalid_argument("more than one log");
+        }
+    }
+    if (s.log.empty()) throw std::invalid_argument("no log");
+    return true;
+}
+
+void printFrame(const ofxVase::CaptureReplay::Frame& f) {
+    printf("%8llu %9zu %9zu %6zu %10zu %6zu %9.3f\n", static_cast<unsigned long long>(f.frameNumber),
+           f.polylines, f.points, f.cacheHits, f.vertices, f.draws, f.seconds * 1e3);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Settings settings;
+    try {
+        if (!parseArgs(argc, argv, settings)) {
+            std::cout << usage;
+            return 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "vase-replay: " << e.what() << "\n\n" << usage;
+        return 2;
+    }
+
+    // Paths are relative to the working directory, not the data folder
+    ofxVase::CaptureReplay replay;
+    if (!replay.load(std::filesystem::absolute(settings.log).string())) return 1;
+    replay.run(settings.repeat);
+
+    const auto& frames = replay.getFrames();
+    size_t polylines = 0, points = 0, cacheHits = 0, vertices = 0;
+    std::vector<double> times;
+    for (const auto& f : frames) {
+        polylines += f.polylines;
+        points += f.points;
+        cacheHits += f.cacheHits;
+        vertices += f.vertices;
+        times.push_back(f.seconds);
+    }
+    std::sort(times.begin(), times.end());
+    auto percentile = [&](double p) {
+        return times.empty() ? 0.0 : times[std::min(times.size() - 1, static_cast<size_t>(p * times.size()))];
+    };
+    double total = replay.getTotalSeconds();
+
+    printf("frames      %zu\n", frames.size());
+    printf("polylines   %zu\n", polylines);
+    printf("points      %zu\n", points);
+    printf("cache hits  %zu  (not replayed)\n", cacheHits);
+    printf("vertices    %zu\n", vertices);
+    printf("tessellate  %.3f s  %.2f Mpoints/s  (fastest of %d)\n",
+           total, total > 0 ? points / total * 1e-6 : 0.0, settings.repeat);
+    printf("frame ms    mean %.3f  median %.3f  p95 %.3f  max %.3f\n",
+           frames.empty() ? 0.0 : total / frames.size() * 1e3,
+           percentile(0.5) * 1e3, percentile(0.95) * 1e3, percentile(1.0) * 1e3);
+
+    std::vector<const ofxVase::CaptureReplay::Frame*> listed;
+    for (const auto& f : frames) listed.push_back(&f);
+    if (!settings.frames) {
+        size_t n = std::min(listed.size(), static_cast<size_t>(settings.top));
+        std::partial_sort(listed.begin(), listed.begin() + n, listed.end(),
+                          [](auto* a, auto* b) { return a->seconds > b->seconds; });
+        listed.resize(n);
+    }
+    if (!listed.empty()) {
+        printf("\n%8s %9s %9s %6s %10s %6s %9s\n", "frame", "polylines", "points", "hits", "vertices",
+               "draws", "ms");
+        for (const auto* f : listed) printFrame(*f);
+    }
+    return 0;
+}
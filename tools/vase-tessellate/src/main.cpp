@@ -0,0 +1,464 @@
+/*
+ * vase-tessellate - Offline batch tessellation with ofxVase
+ *
+ * Reads polylines from CSV or binary point files, tessellates them on all
+ * cores and writes an ofxVase mesh file (see ofxVaseMeshFile.h) or a plain
+ * vertex dump. Without an output it only reports timings, as a throughput
+ * benchmark.
+ *
+ * CSV: one point per line, "x,y[,width[,r,g,b[,a]]]" with colors 0..1.
+ * A blank line ends a polyline; lines starting with '#' and a header line are
+ * skipped. Missing widths and colors come from --width and --color.
+ *
+ * Binary points (memory-mapped, read in place), version 1, little-endian:
+ *   header     64 bytes: "VASP", version, flags (1: widths, 2: colors),
+ *              polyline count, point count, then the byte offsets of the
+ *              polyline table, points, widths and colors, each 16-byte aligned
+ *   polylines  uint64 first point, uint64 point count
+ *   points     vec2 per point
+ *   widths     float per point (flag 1)
+ *   colors     ofFloatColor per point (flag 2)
+ */
+
+#include "ofMain.h"
+#include "ofxVase.h"
+#include "ofxVaseMeshFile.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+const char* usage =
+    "usage: vase-tessellate [options] input...\n"
+    "\n"
+    "output\n"
+    "  -o, --output FILE     write FILE (default: tessellate and report only)\n"
+    "  --format FORMAT       mesh (default for .vasm), text (.txt) or dump (anything else):\n"
+    "                        dump is raw float x,y,r,g,b,a per vertex, text the same as lines\n"
+    "  --indexed             mesh files: merge duplicate vertices and write indices\n"
+    "  --bench               print timings and throughput\n"
+    "\n"
+    "stroke\n"
+    "  --width W             width for points without one (2)\n"
+    "  --color R,G,B[,A]     color for points without one, 0..1 (1,1,1,1)\n"
+    "  --joint STYLE         miter, bevel or round (round)\n"
+    "  --cap STYLE           butt, round or square (round)\n"
+    "  --miter-limit L       (4)\n"
+    "  --feather AMOUNT      feathering amount (1)\n"
+    "  --no-feather\n"
+    "  --smoothing N         Catmull-Rom subdivisions per segment (0)\n"
+    "  --tolerance PX        adaptive smoothing, at most PX from the curve\n"
+    "  --scale S             world to screen ratio (1)\n"
+    "  --quality LEVEL       draft, normal or high: arc vertices and approximation\n"
+    "                        thresholds, set after the options above (normal)\n"
+    "  --hairline PX         strokes up to PX screen pixels wide take the hairline\n"
+    "                        kernel (0: off)\n"
+    "  --hairline-lines      hairlines as GL_LINES: dump and text output are vertex\n"
+    "                        pairs, mesh files get one-unit quads\n"
+    "\n"
+    "  -j, --threads N       worker threads (all cores)\n"
+    "  -h, --help\n";
+
+enum class Format { Mesh, Text, Dump };
+
+struct Settings {
+    ofxVase::Options opt;
+    float width = 2.0f;
+    ofFloatColor color = ofFloatColor(1, 1, 1, 1);
+    std::string output;
+    Format format = Format::Dump;
+    bool formatSet = false;
+    bool indexed = false;
+    bool bench = false;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> inputs;
+};
+
+// One polyline, viewing the mapped file or the parsed CSV values
+struct Line {
+    ofxVase::PointView points;
+    ofxVase::ColorView colors;
+    ofxVase::WidthView widths;
+};
+
+struct Input {
+    std::string path;
+    ofxVase::MappedFile file;
+    std::vector<glm::vec2> points;  // parsed CSV
+    std::vector<float> widths;
+    std::vector<ofFloatColor> colors;
+    std::vector<Line> lines;
+};
+
+struct PointFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t polylineCount;
+    uint64_t pointCount;
+    uint64_t polylinesOffset;
+    uint64_t pointsOffset;
+    uint64_t widthsOffset;
+    uint64_t colorsOffset;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(PointFileHeader) == 64, "point file header layout");
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool sectionFits(uint64_t offset, uint64_t count, size_t size, size_t fileSize) {
+    if (offset % 16 != 0 || offset > fileSize) return false;
+    return count <= (fileSize - offset) / size;
+}
+
+// ============================================================================
+// Arguments
+// ============================================================================
+
+bool parseColor(const std::string& s, ofFloatColor& color) {
+    float v[4] = { 0, 0, 0, 1 };
+    int n = sscanf(s.c_str(), "%f,%f,%f,%f", &v[0], &v[1], &v[2], &v[3]);
+    if (n < 3) return false;
+    color = ofFloatColor(v[0], v[1], v[2], v[3]);
+    return true;
+}
+
+bool parseArgs(int argc, char** argv, Settings& s) {
+    float tolerance = 0.0f;
+    ofxVase::Quality quality = ofxVase::Quality::Normal;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg == "-o" || arg == "--output") {
+            s.output = value();
+        } else if (arg == "--format") {
+            std::string f = value();
+            if (f == "mesh") s.format = Format::Mesh;
+            else if (f == "text") s.format = Format::Text;
+            else if (f == "dump") s.format = Format::Dump;
+            else throw std::invalid_argument("unknown format " + f);
+            s.formatSet = true;
+        } else if (arg == "--indexed") {
+            s.indexed = true;
+        } else if (arg == "--bench") {
+            s.bench = true;
+        } else if (arg == "--width") {
+            s.width = std::stof(value());
+        } else if (arg == "--color") {
+            if (!parseColor(value(), s.color)) throw std::invalid_argument("--color needs R,G,B[,A]");
+        } else if (arg == "--joint") {
+            std::string j = value();
+            if (j == "miter") s.opt.joint = ofxVase::JointStyle::Miter;
+            else if (j == "bevel") s.opt.joint = ofxVase::JointStyle::Bevel;
+            else if (j == "round") s.opt.joint = ofxVase::JointStyle::Round;
+            else throw std::invalid_argument("unknown joint " + j);
+        } else if (arg == "--cap") {
+            std::string c = value();
+            if (c == "butt") s.opt.cap = ofxVase::CapStyle::Butt;
+            else if (c == "round") s.opt.cap = ofxVase::CapStyle::Round;
+            else if (c == "square") s.opt.cap = ofxVase::CapStyle::Square;
+            else throw std::invalid_argument("unknown cap " + c);
+        } else if (arg == "--miter-limit") {
+            s.opt.miterLimit = std::stof(value());
+        } else if (arg == "--feather") {
+            s.opt.setFeather(true, std::stof(value()));
+        } else if (arg == "--no-feather") {
+            s.opt.feather = false;
+        } else if (arg == "--smoothing") {
+            s.opt.smoothing = std::stoi(value());
+        } else if (arg == "--tolerance") {
+            tolerance = std::stof(value());
+        } else if (arg == "--scale") {
+            s.opt.worldToScreenRatio = std::stof(value());
+        } else if (arg == "--quality") {
+            std::string q = value();
+            if (q == "draft") quality = ofxVase::Quality::Draft;
+            else if (q == "normal") quality = ofxVase::Quality::Normal;
+            else if (q == "high") quality = ofxVase::Quality::High;
+            else throw std::invalid_argument("unknown quality " + q);
+        } else if (arg == "--hairline") {
+            s.opt.hairlineWidth = std::stof(value());
+        } else if (arg == "--hairline-lines") {
+            s.opt.hairlineLines = true;
+        } else if (arg == "-j" || arg == "--threads") {
+            s.threads = std::max(1, std::stoi(value()));
+        } else if (!arg.empty() && arg[0] == '-') {
+            throw std::invalid_argument("unknown option " + arg);
+        } else {
+            s.inputs.push_back(arg);
+        }
+    }
+    if (tolerance > 0) {
+        s.opt.setAdaptiveSmoothing(tolerance, s.opt.smoothing > 0 ? s.opt.smoothing : 16);
+    }
+    s.opt.setQuality(quality);
+    if (!s.formatSet) {
+        std::string ext = std::filesystem::path(s.output).extension().string();
+        s.format = ext == ".vasm" ? Format::Mesh : ext == ".txt" ? Format::Text : Format::Dump;
+    }
+    if (s.inputs.empty()) throw std::invalid_argument("no input files");
+    if (s.output.empty() && !s.bench) throw std::invalid_argument("nothing to do: give -o or --bench");
+    return true;
+}
+
+// ============================================================================
+// Input
+// ============================================================================
+
+bool readBinary(Input& in, const Settings& s) {
+    const unsigned char* base = in.file.data();
+    size_t size = in.file.size();
+    PointFileHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, base, sizeof(header));
+    if (header.version != 1) {
+        std::cerr << in.path << ": unsupported version " << header.version << "\n";
+        return false;
+    }
+    bool hasWidths = header.flags & 1;
+    bool hasColors = header.flags & 2;
+    if (!sectionFits(header.polylinesOffset, header.polylineCount, 2 * sizeof(uint64_t), size) ||
+        !sectionFits(header.pointsOffset, header.pointCount, sizeof(glm::vec2), size) ||
+        (hasWidths && !sectionFits(header.widthsOffset, header.pointCount, sizeof(float), size)) ||
+        (hasColors && !sectionFits(header.colorsOffset, header.pointCount, sizeof(ofFloatColor), size))) {
+        std::cerr << in.path << ": truncated\n";
+        return false;
+    }
+
+    const glm::vec2* points = reinterpret_cast<const glm::vec2*>(base + header.pointsOffset);
+    const float* widths = reinterpret_cast<const float*>(base + header.widthsOffset);
+    const ofFloatColor* colors = reinterpret_cast<const ofFloatColor*>(base + header.colorsOffset);
+    for (uint32_t i = 0; i < header.polylineCount; i++) {
+        uint64_t range[2];
+        memcpy(range, base + header.polylinesOffset + i * sizeof(range), sizeof(range));
+        if (range[0] > header.pointCount || range[1] > header.pointCount - range[0]) {
+            std::cerr << in.path << ": polyline " << i << " out of range\n";
+            return false;
+        }
+        Line line;
+        line.points = ofxVase::PointView(points + range[0], range[1]);
+        line.widths = hasWidths ? ofxVase::WidthView(widths + range[0], range[1])
+                                : ofxVase::WidthView(&s.width, 1);
+        line.colors = hasColors ? ofxVase::ColorView(colors + range[0], range[1])
+                                : ofxVase::ColorView(&s.color, 1);
+        in.lines.push_back(line);
+    }
+    return true;
+}
+
+bool readCsv(Input& in, const Settings& s) {
+    struct Range {
+        size_t first = 0, count = 0;
+        bool widths = false, colors = false;
+    };
+    std::vector<Range> ranges;
+    Range current;
+    auto endLine = [&]() {
+        if (current.count > 0) ranges.push_back(current);
+        current = Range();
+        current.first = in.points.size();
+    };
+
+    const char* p = reinterpret_cast<const char*>(in.file.data());
+    const char* end = p + in.file.size();
+    std::string text;
+    int lineNumber = 0;
+    while (p < end) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+        text.assign(p, eol);
+        p = eol + 1;
+        lineNumber++;
+
+        size_t start = text.find_first_not_of(" \t\r");
+        if (start == std::string::npos) {
+            endLine();
+            continue;
+        }
+        if (text[start] == '#') continue;
+
+        float v[7];
+        int n = 0;
+        const char* c = text.c_str() + start;
+        while (n < 7 && *c) {
+            char* next = nullptr;
+            v[n] = strtof(c, &next);
+            if (next == c) break;
+            n++;
+            c = next + strspn(next, " \t\r,;");
+        }
+        if (n == 0 && lineNumber == 1) continue;  // header
+        if (n < 2 || n == 4 || n == 5 || *c) {
+            std::cerr << in.path << ":" << lineNumber << ": expected x,y[,width[,r,g,b[,a]]]\n";
+            return false;
+        }
+        in.points.push_back(glm::vec2(v[0], v[1]));
+        in.widths.push_back(n >= 3 ? v[2] : s.width);
+        in.colors.push_back(n >= 6 ? ofFloatColor(v[3], v[4], v[5], n == 7 ? v[6] : 1.0f) : s.color);
+        current.widths |= n >= 3;
+        current.colors |= n >= 6;
+        current.count++;
+    }
+    endLine();
+
+    // Polylines without width or color columns take the constant path
+    for (const Range& r : ranges) {
+        Line line;
+        line.points = ofxVase::PointView(&in.points[r.first], r.count);
+        line.widths = r.widths ? ofxVase::WidthView(&in.widths[r.first], r.count)
+                               : ofxVase::WidthView(&s.width, 1);
+        line.colors = r.colors ? ofxVase::ColorView(&in.colors[r.first], r.count)
+                               : ofxVase::ColorView(&s.color, 1);
+        in.lines.push_back(line);
+    }
+    return true;
+}
+
+bool readInput(Input& in, const Settings& s) {
+    if (!in.file.open(in.path)) {
+        std::cerr << in.path << ": cannot open\n";
+        return false;
+    }
+    if (in.file.size() >= 4 && memcmp(in.file.data(), "VASP", 4) == 0) {
+        return readBinary(in, s);
+    }
+    return readCsv(in, s);
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+bool writeOutput(const std::vector<ofxVase::VertexArrayHolder>& results, const Settings& s) {
+    // Paths are relative to the working directory, not the data folder
+    std::string path = std::filesystem::absolute(s.output).string();
+
+    if (s.format == Format::Mesh) {
+        ofxVase::MeshFileWriter writer(s.indexed);
+        for (const auto& holder : results) {
+            writer.add(holder);
+        }
+        return writer.save(path);
+    }
+
+    std::ofstream out(path, s.format == Format::Dump ? std::ios::binary : std::ios::out);
+    if (s.format == Format::Dump) {
+        std::vector<float> buffer;
+        for (const auto& holder : results) {
+            buffer.resize(holder.vertices.size() * 6);
+            ofxVase::InterleavedSink sink(buffer.data(), holder.vertices.size());
+            sink.write(holder.vertices.data(), holder.colors.data(), holder.vertices.size());
+            out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(float));
+        }
+    } else {
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto& holder = results[i];
+            out << "# stroke " << i << " " << holder.vertices.size() << "\n";
+            for (size_t v = 0; v < holder.vertices.size(); v++) {
+                const ofFloatColor& c = holder.colors[v];
+                out << holder.vertices[v].x << " " << holder.vertices[v].y << " "
+                    << c.r << " " << c.g << " " << c.b << " " << c.a << "\n";
+            }
+        }
+    }
+    out.close();
+    if (!out) {
+        std::cerr << path << ": cannot write\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Settings settings;
+    try {
+        if (!parseArgs(argc, argv, settings)) {
+            std::cout << usage;
+            return 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "vase-tessellate: " << e.what() << "\n\n" << usage;
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<Input>> inputs;
+    std::vector<const Line*> jobs;
+    size_t pointCount = 0;
+    for (const std::string& path : settings.inputs) {
+        inputs.push_back(std::make_unique<Input>());
+        Input& in = *inputs.back();
+        in.path = path;
+        if (!readInput(in, settings)) return 1;
+        for (const Line& line : in.lines) {
+            jobs.push_back(&line);
+            pointCount += line.points.size();
+        }
+    }
+    double readTime = secondsSince(start);
+
+    // Workers take polylines in turn, each rebuilding its own Polyline. Results
+    // are kept for writing in input order; a benchmark only counts them.
+    start = std::chrono::steady_clock::now();
+    bool keep = !settings.output.empty();
+    std::vector<ofxVase::VertexArrayHolder> results(keep ? jobs.size() : 0);
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> vertexCount(0);
+    auto work = [&]() {
+        ofxVase::Polyline poly;
+        size_t vertices = 0;
+        for (size_t i = next++; i < jobs.size(); i = next++) {
+            const Line& line = *jobs[i];
+            if (line.colors.size() == 1 && line.widths.size() == 1) {
+                poly.rebuild(line.points, line.colors[0], line.widths[0], settings.opt);
+            } else {
+                poly.rebuild(line.points, line.colors, line.widths, settings.opt);
+            }
+            vertices += poly.holder.vertices.size();
+            if (keep) results[i] = poly.holder;
+        }
+        vertexCount += vertices;
+    };
+    int threadCount = static_cast<int>(std::min<size_t>(settings.threads, std::max<size_t>(1, jobs.size())));
+    std::vector<std::thread> threads;
+    for (int t = 1; t < threadCount; t++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& t : threads) {
+        t.join();
+    }
+    double tessellateTime = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    if (keep && !writeOutput(results, settings)) return 1;
+    double writeTime = secondsSince(start);
+
+    if (settings.bench) {
+        printf("inputs      %zu\n", inputs.size());
+        printf("polylines   %zu\n", jobs.size());
+        printf("points      %zu\n", pointCount);
+        printf("vertices    %zu\n", vertexCount.load());
+        printf("read        %.3f s\n", readTime);
+        printf("tessellate  %.3f s  %.2f Mpoints/s  %.2f Mvertices/s  (%d threads)\n",
+               tessellateTime, pointCount / tessellateTime * 1e-6,
+               vertexCount / tessellateTime * 1e-6, threadCount);
+        if (!settings.output.empty()) printf("write       %.3f s\n", writeTime);
+    }
+    return 0;
+}